@@ -0,0 +1,291 @@
+// adc.c
+//
+// Runs the expansions listed in a manifest, so projects don't need to write
+// and compile their own metaprogram.
+//
+//      adc [-j threads] [-w] [-v] [-s stats.json] manifest
+//
+// Manifest lines, in order. '#' starts a comment. Arguments are separated by
+// spaces; double quotes keep spaces in an argument, e.g. type="unsigned int".
+//
+//      clear    <output>
+//      expand   <output> <template> [name=value ...]
+//      typeinfo <output> <directory>
+//
+// Expansions run on a job list: outputs are generated in parallel, every
+// template is compiled once, and files that start with `clear` are only
+// written if they changed, with a depfile at <output>.d. Type info runs after
+// the expansions, one directory at a time. Paths are relative to the current
+// directory. adc exits with 1 if the manifest has an error, or if a template
+// didn't compile or an output couldn't be written.
+//
+// With -w (Linux only), adc keeps running after the first pass and regenerates
+// the outputs affected by every change to a template or a source file.
+//
+// -v prints what the type info parser finds. -s writes the time spent walking,
+// reading, lexing, parsing and emitting, and what was read, as JSON after the
+// first pass (see MetaStats in meta.h).
+//
+// Build with: cc -O2 -std=c99 adc.c -o adc -lpthread
+
+#include "meta.h"
+
+typedef struct
+{
+    const char* output;
+    const char* directory;
+} TypeInfoJob;
+
+// Splits one manifest line into arguments, in place. Quotes are removed and
+// \" or \\ inside quotes are unescaped. Returns the number of arguments, or -1
+// if a quote isn't closed.
+static int split_line(char* line, char** args, int max_args)
+{
+    int num_args = 0;
+    char* c = line;
+    for (;;)
+    {
+        while (*c == ' ' || *c == '\t' || *c == '\r')
+        {
+            ++c;
+        }
+        if (!*c || *c == '#')
+        {
+            break;
+        }
+        if (num_args == max_args)
+        {
+            return -1;
+        }
+        args[num_args++] = c;
+
+        char* out = c;
+        int quoted = 0;
+        while (*c && (quoted || (*c != ' ' && *c != '\t' && *c != '\r')))
+        {
+            if (*c == '"')
+            {
+                quoted = !quoted;
+                ++c;
+            }
+            else if (quoted && *c == '\\' && (c[1] == '"' || c[1] == '\\'))
+            {
+                *out++ = c[1];
+                c += 2;
+            }
+            else
+            {
+                *out++ = *c++;
+            }
+        }
+        if (quoted)
+        {
+            return -1;
+        }
+        int at_end = !*c;
+        *out = '\0';
+        if (at_end)
+        {
+            break;
+        }
+        ++c;
+    }
+    return num_args;
+}
+
+#define ADC_MAX_ARGS 256
+
+int main(int argc, char** argv)
+{
+    int num_threads = 0;
+    int watch_mode = 0;
+    const char* stats_path = NULL;
+    const char* manifest_path = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-j") && i + 1 < argc)
+        {
+            num_threads = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-w"))
+        {
+            watch_mode = 1;
+        }
+        else if (!strcmp(argv[i], "-v"))
+        {
+            meta_set_verbose(1);
+        }
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+        {
+            stats_path = argv[++i];
+        }
+        else if (!manifest_path && argv[i][0] != '-')
+        {
+            manifest_path = argv[i];
+        }
+        else
+        {
+            manifest_path = NULL;
+            break;
+        }
+    }
+    if (!manifest_path)
+    {
+        fprintf(stderr, "Usage: %s [-j threads] [-w] [-v] [-s stats.json] manifest\n", argv[0]);
+        return 1;
+    }
+#if !defined(__linux__)
+    if (watch_mode)
+    {
+        fprintf(stderr, "Watch mode needs inotify, which is Linux only\n");
+        return 1;
+    }
+#endif
+
+    MetaMappedFile mapped;
+    if (!meta_map_file(manifest_path, &mapped))
+    {
+        fprintf(stderr, "Could not open manifest %s\n", manifest_path);
+        return 1;
+    }
+    // Arguments point into this copy until the jobs have run.
+    char* manifest = (char*)malloc(mapped.size + 1);
+    assert(manifest);
+    memcpy(manifest, mapped.data, mapped.size);
+    manifest[mapped.size] = '\0';
+    meta_unmap_file(&mapped);
+
+    MetaJobList* jobs = meta_jobs_create();
+    meta_jobs_write_depfiles(jobs, 1);
+    TypeInfoJob* type_info_jobs = NULL;  // sb_
+    MetaBinding* bindings = NULL;  // sb_, reused for every line
+
+    int ok = 1;
+    int line_number = 0;
+    char* line = manifest;
+    while (line && ok)
+    {
+        ++line_number;
+        char* next = strchr(line, '\n');
+        if (next)
+        {
+            *next++ = '\0';
+        }
+
+        char* args[ADC_MAX_ARGS];
+        int num_args = split_line(line, args, ADC_MAX_ARGS);
+        line = next;
+        if (num_args == 0)
+        {
+            continue;
+        }
+
+        ok = 0;
+        if (num_args < 0)
+        {
+            fprintf(stderr, "%s:%d: unterminated quote or too many arguments\n", manifest_path, line_number);
+        }
+        else if (!strcmp(args[0], "clear") && num_args == 2)
+        {
+            meta_jobs_clear(jobs, args[1]);
+            ok = 1;
+        }
+        else if (!strcmp(args[0], "expand") && num_args >= 3)
+        {
+            if (bindings)
+            {
+                sb_reset(bindings);
+            }
+            ok = 1;
+            for (int i = 3; i < num_args && ok; ++i)
+            {
+                char* equals = strchr(args[i], '=');
+                if (!equals)
+                {
+                    fprintf(stderr, "%s:%d: expected name=value, got %s\n", manifest_path, line_number, args[i]);
+                    ok = 0;
+                    break;
+                }
+                *equals = '\0';
+                MetaBinding binding = { args[i], equals + 1 };
+                sb_push(bindings, binding);
+            }
+            if (ok)
+            {
+                meta_jobs_expand(jobs, args[1], args[2], bindings, sb_count(bindings));
+            }
+        }
+        else if (!strcmp(args[0], "typeinfo") && num_args == 3)
+        {
+            TypeInfoJob job = { args[1], args[2] };
+            sb_push(type_info_jobs, job);
+            ok = 1;
+        }
+        else
+        {
+            fprintf(stderr, "%s:%d: expected clear <output>, expand <output> <template> [name=value ...] "
+                    "or typeinfo <output> <directory>\n", manifest_path, line_number);
+        }
+    }
+
+#if defined(__linux__)
+    MetaWatch* watch = ok && watch_mode ? meta_watch_create() : NULL;
+    if (watch)
+    {
+        meta_watch_jobs(watch, jobs);
+        for (int i = 0; i < sb_count(type_info_jobs); ++i)
+        {
+            meta_watch_type_info(watch, type_info_jobs[i].output, type_info_jobs[i].directory);
+        }
+        if (stats_path)
+        {
+            meta_stats_write_json(stats_path);
+        }
+        printf("Watching for changes...\n");
+        for (;;)
+        {
+            int regenerated = meta_watch_poll(watch, -1);
+            if (regenerated < 0)
+            {
+                ok = 0;
+                break;
+            }
+            if (regenerated)
+            {
+                printf("Regenerated %d output%s\n", regenerated, regenerated == 1 ? "" : "s");
+                fflush(stdout);
+            }
+        }
+        meta_watch_free(watch);
+    }
+    else if (watch_mode)
+    {
+        ok = 0;
+    }
+    else
+#endif
+    if (ok)
+    {
+        if (meta_jobs_run(jobs, num_threads))
+        {
+            ok = 0;
+        }
+        for (int i = 0; i < sb_count(type_info_jobs); ++i)
+        {
+            if (meta_type_info(type_info_jobs[i].output, type_info_jobs[i].directory) < 0)
+            {
+                ok = 0;
+            }
+        }
+        if (stats_path && !meta_stats_write_json(stats_path))
+        {
+            ok = 0;
+        }
+    }
+
+    meta_jobs_free(jobs);
+    meta__sb_free(type_info_jobs);
+    meta__sb_free(bindings);
+    free(manifest);
+    return ok ? 0 : 1;
+}
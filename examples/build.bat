@@ -3,8 +3,28 @@
 :: Compile metaprogram
 cl metaprogram.c /D_CRT_SECURE_NO_WARNINGS /W4 /Zi -I ..\
 
+:: Embed the templates, and rebuild the metaprogram so it doesn't read them
+metaprogram.exe --embed
+cl metaprogram.c /DEMBED_TEMPLATES /D_CRT_SECURE_NO_WARNINGS /W4 /Zi -I ..\
+
 :: Generate code
 metaprogram.exe
 
 :: Compile actual program
 cl program.c /W4 /Zi
+
+:: Check the generated vector operations
+cl vector_ops_test.c /W4 /Zi
+vector_ops_test.exe
+
+:: Check the generated containers
+cl containers_test.c /W4 /Zi
+containers_test.exe
+
+:: Check the generated serialization
+cl serial_test.c /W4 /Zi
+serial_test.exe
+
+:: Check the generated string lookups
+cl lookup_test.c /W4 /Zi
+lookup_test.exe
@@ -0,0 +1,614 @@
+//File generated from template by libserg/meta.h.
+
+//../templates/array.adc
+
+// Typed dynamic array.
+//
+// Bindings:
+//  name    -- array type
+//  type    -- element type
+//
+// Zero-initialized arrays are empty and ready to use. Pointers into `data`
+// are invalidated by anything that grows the array.
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct FloatArray_s
+{
+    float* data;
+    size_t count;
+    size_t capacity;
+} FloatArray;
+
+static inline void FloatArray_free(FloatArray* a)
+{
+    free(a->data);
+    a->data = NULL;
+    a->count = 0;
+    a->capacity = 0;
+}
+
+static inline void FloatArray_reserve(FloatArray* a, size_t capacity)
+{
+    if (capacity > a->capacity)
+    {
+        size_t grown = a->capacity ? 2 * a->capacity : 16;
+        if (grown < capacity)
+        {
+            grown = capacity;
+        }
+        a->data = (float*)realloc(a->data, grown * sizeof(float));
+        assert(a->data);
+        a->capacity = grown;
+    }
+}
+
+// Returns the new element.
+static inline float* FloatArray_push(FloatArray* a, float value)
+{
+    if (a->count == a->capacity)
+    {
+        FloatArray_reserve(a, a->count + 1);
+    }
+    a->data[a->count] = value;
+    return &a->data[a->count++];
+}
+
+// Appends n uninitialized elements and returns the first one.
+static inline float* FloatArray_add(FloatArray* a, size_t n)
+{
+    FloatArray_reserve(a, a->count + n);
+    a->count += n;
+    return &a->data[a->count - n];
+}
+
+static inline float FloatArray_pop(FloatArray* a)
+{
+    assert(a->count);
+    return a->data[--a->count];
+}
+
+static inline float* FloatArray_last(FloatArray* a)
+{
+    assert(a->count);
+    return &a->data[a->count - 1];
+}
+
+// O(1). Moves the last element into slot i.
+static inline void FloatArray_swap_remove(FloatArray* a, size_t i)
+{
+    assert(i < a->count);
+    a->data[i] = a->data[--a->count];
+}
+
+// O(n). Keeps the order of the remaining elements.
+static inline void FloatArray_remove(FloatArray* a, size_t i)
+{
+    assert(i < a->count);
+    memmove(&a->data[i], &a->data[i + 1], (a->count - i - 1) * sizeof(float));
+    --a->count;
+}
+
+static inline void FloatArray_clear(FloatArray* a)
+{
+    a->count = 0;
+}
+
+//../templates/hash_map.adc
+
+// Open-addressing hash map with linear probing.
+//
+// Bindings:
+//  name            -- map type
+//  key             -- key type
+//  value           -- value type
+//  key_is_string   -- 1 if keys are NUL-terminated strings. They are hashed
+//                     and compared by contents, and are not copied: they must
+//                     outlive the map. With 0, keys are hashed and compared
+//                     bytewise, so struct keys must not have padding.
+//
+// Zero-initialized maps are empty and ready to use. Hashes, keys and values
+// live in separate arrays, so probing only touches the hashes. Slot i is in
+// use when hashes[i] != 0, which is how to iterate over the map.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct NameMap_s
+{
+    uint32_t* hashes;
+    const char** keys;
+    int32_t* values;
+    size_t count;
+    size_t capacity;    // Power of two
+} NameMap;
+
+#if 1
+static inline uint32_t NameMap_hash(const char* k)
+{
+    uint32_t h = 2166136261u;
+    for (const char* c = k; *c; ++c)
+    {
+        h = (h ^ (uint8_t)*c) * 16777619u;
+    }
+    return h;
+}
+
+static inline int NameMap_eq(const char* a, const char* b)
+{
+    return strcmp(a, b) == 0;
+}
+#else
+static inline uint32_t NameMap_hash(const char* k)
+{
+    const uint8_t* bytes = (const uint8_t*)&k;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(k); ++i)
+    {
+        h = (h ^ bytes[i]) * 16777619u;
+    }
+    // Spread small integer keys over the low bits used for slots.
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+static inline int NameMap_eq(const char* a, const char* b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+#endif
+
+static inline void NameMap_free(NameMap* m)
+{
+    free(m->hashes);
+    free(m->keys);
+    free(m->values);
+    memset(m, 0, sizeof(*m));
+}
+
+static inline void NameMap_clear(NameMap* m)
+{
+    if (m->hashes)
+    {
+        memset(m->hashes, 0, m->capacity * sizeof(uint32_t));
+    }
+    m->count = 0;
+}
+
+// Stored hashes are never 0, which marks empty slots.
+static inline uint32_t NameMap__stored_hash(const char* k)
+{
+    return NameMap_hash(k) | 0x80000000u;
+}
+
+// Slot holding k, or the empty slot where it would go.
+static inline size_t NameMap__probe(const NameMap* m, const char* k, uint32_t h)
+{
+    size_t mask = m->capacity - 1;
+    size_t i = h & mask;
+    while (m->hashes[i] && !(m->hashes[i] == h && NameMap_eq(m->keys[i], k)))
+    {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static inline void NameMap__grow(NameMap* m)
+{
+    NameMap grown;
+    grown.count = m->count;
+    grown.capacity = m->capacity ? 2 * m->capacity : 16;
+    grown.hashes = (uint32_t*)calloc(grown.capacity, sizeof(uint32_t));
+    grown.keys = (const char**)malloc(grown.capacity * sizeof(const char*));
+    grown.values = (int32_t*)malloc(grown.capacity * sizeof(int32_t));
+    assert(grown.hashes && grown.keys && grown.values);
+    for (size_t i = 0; i < m->capacity; ++i)
+    {
+        if (m->hashes[i])
+        {
+            size_t mask = grown.capacity - 1;
+            size_t j = m->hashes[i] & mask;
+            while (grown.hashes[j])
+            {
+                j = (j + 1) & mask;
+            }
+            grown.hashes[j] = m->hashes[i];
+            grown.keys[j] = m->keys[i];
+            grown.values[j] = m->values[i];
+        }
+    }
+    NameMap_free(m);
+    *m = grown;
+}
+
+// Returns the value for k, or NULL.
+static inline int32_t* NameMap_find(NameMap* m, const char* k)
+{
+    if (!m->count)
+    {
+        return NULL;
+    }
+    size_t i = NameMap__probe(m, k, NameMap__stored_hash(k));
+    return m->hashes[i] ? &m->values[i] : NULL;
+}
+
+// Sets the value for k, adding k if it isn't in the map. Returns the stored value.
+static inline int32_t* NameMap_insert(NameMap* m, const char* k, int32_t v)
+{
+    // Keep the load factor under 1/2
+    if (2 * (m->count + 1) > m->capacity)
+    {
+        NameMap__grow(m);
+    }
+    uint32_t h = NameMap__stored_hash(k);
+    size_t i = NameMap__probe(m, k, h);
+    if (!m->hashes[i])
+    {
+        m->hashes[i] = h;
+        m->keys[i] = k;
+        ++m->count;
+    }
+    m->values[i] = v;
+    return &m->values[i];
+}
+
+// Returns 1 if k was in the map. Later entries are shifted back into the
+// hole, so lookups never need tombstones.
+static inline int NameMap_remove(NameMap* m, const char* k)
+{
+    if (!m->count)
+    {
+        return 0;
+    }
+    size_t i = NameMap__probe(m, k, NameMap__stored_hash(k));
+    if (!m->hashes[i])
+    {
+        return 0;
+    }
+    size_t mask = m->capacity - 1;
+    size_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (!m->hashes[j])
+        {
+            break;
+        }
+        // Entry j can fill the hole if its home slot isn't between the hole and j.
+        size_t home = m->hashes[j] & mask;
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            m->hashes[i] = m->hashes[j];
+            m->keys[i] = m->keys[j];
+            m->values[i] = m->values[j];
+            i = j;
+        }
+    }
+    m->hashes[i] = 0;
+    --m->count;
+    return 1;
+}
+
+//../templates/hash_map.adc
+
+// Open-addressing hash map with linear probing.
+//
+// Bindings:
+//  name            -- map type
+//  key             -- key type
+//  value           -- value type
+//  key_is_string   -- 1 if keys are NUL-terminated strings. They are hashed
+//                     and compared by contents, and are not copied: they must
+//                     outlive the map. With 0, keys are hashed and compared
+//                     bytewise, so struct keys must not have padding.
+//
+// Zero-initialized maps are empty and ready to use. Hashes, keys and values
+// live in separate arrays, so probing only touches the hashes. Slot i is in
+// use when hashes[i] != 0, which is how to iterate over the map.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct IdMap_s
+{
+    uint32_t* hashes;
+    uint32_t* keys;
+    float* values;
+    size_t count;
+    size_t capacity;    // Power of two
+} IdMap;
+
+#if 0
+static inline uint32_t IdMap_hash(uint32_t k)
+{
+    uint32_t h = 2166136261u;
+    for (const char* c = k; *c; ++c)
+    {
+        h = (h ^ (uint8_t)*c) * 16777619u;
+    }
+    return h;
+}
+
+static inline int IdMap_eq(uint32_t a, uint32_t b)
+{
+    return strcmp(a, b) == 0;
+}
+#else
+static inline uint32_t IdMap_hash(uint32_t k)
+{
+    const uint8_t* bytes = (const uint8_t*)&k;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < sizeof(k); ++i)
+    {
+        h = (h ^ bytes[i]) * 16777619u;
+    }
+    // Spread small integer keys over the low bits used for slots.
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+static inline int IdMap_eq(uint32_t a, uint32_t b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+#endif
+
+static inline void IdMap_free(IdMap* m)
+{
+    free(m->hashes);
+    free(m->keys);
+    free(m->values);
+    memset(m, 0, sizeof(*m));
+}
+
+static inline void IdMap_clear(IdMap* m)
+{
+    if (m->hashes)
+    {
+        memset(m->hashes, 0, m->capacity * sizeof(uint32_t));
+    }
+    m->count = 0;
+}
+
+// Stored hashes are never 0, which marks empty slots.
+static inline uint32_t IdMap__stored_hash(uint32_t k)
+{
+    return IdMap_hash(k) | 0x80000000u;
+}
+
+// Slot holding k, or the empty slot where it would go.
+static inline size_t IdMap__probe(const IdMap* m, uint32_t k, uint32_t h)
+{
+    size_t mask = m->capacity - 1;
+    size_t i = h & mask;
+    while (m->hashes[i] && !(m->hashes[i] == h && IdMap_eq(m->keys[i], k)))
+    {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static inline void IdMap__grow(IdMap* m)
+{
+    IdMap grown;
+    grown.count = m->count;
+    grown.capacity = m->capacity ? 2 * m->capacity : 16;
+    grown.hashes = (uint32_t*)calloc(grown.capacity, sizeof(uint32_t));
+    grown.keys = (uint32_t*)malloc(grown.capacity * sizeof(uint32_t));
+    grown.values = (float*)malloc(grown.capacity * sizeof(float));
+    assert(grown.hashes && grown.keys && grown.values);
+    for (size_t i = 0; i < m->capacity; ++i)
+    {
+        if (m->hashes[i])
+        {
+            size_t mask = grown.capacity - 1;
+            size_t j = m->hashes[i] & mask;
+            while (grown.hashes[j])
+            {
+                j = (j + 1) & mask;
+            }
+            grown.hashes[j] = m->hashes[i];
+            grown.keys[j] = m->keys[i];
+            grown.values[j] = m->values[i];
+        }
+    }
+    IdMap_free(m);
+    *m = grown;
+}
+
+// Returns the value for k, or NULL.
+static inline float* IdMap_find(IdMap* m, uint32_t k)
+{
+    if (!m->count)
+    {
+        return NULL;
+    }
+    size_t i = IdMap__probe(m, k, IdMap__stored_hash(k));
+    return m->hashes[i] ? &m->values[i] : NULL;
+}
+
+// Sets the value for k, adding k if it isn't in the map. Returns the stored value.
+static inline float* IdMap_insert(IdMap* m, uint32_t k, float v)
+{
+    // Keep the load factor under 1/2
+    if (2 * (m->count + 1) > m->capacity)
+    {
+        IdMap__grow(m);
+    }
+    uint32_t h = IdMap__stored_hash(k);
+    size_t i = IdMap__probe(m, k, h);
+    if (!m->hashes[i])
+    {
+        m->hashes[i] = h;
+        m->keys[i] = k;
+        ++m->count;
+    }
+    m->values[i] = v;
+    return &m->values[i];
+}
+
+// Returns 1 if k was in the map. Later entries are shifted back into the
+// hole, so lookups never need tombstones.
+static inline int IdMap_remove(IdMap* m, uint32_t k)
+{
+    if (!m->count)
+    {
+        return 0;
+    }
+    size_t i = IdMap__probe(m, k, IdMap__stored_hash(k));
+    if (!m->hashes[i])
+    {
+        return 0;
+    }
+    size_t mask = m->capacity - 1;
+    size_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (!m->hashes[j])
+        {
+            break;
+        }
+        // Entry j can fill the hole if its home slot isn't between the hole and j.
+        size_t home = m->hashes[j] & mask;
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            m->hashes[i] = m->hashes[j];
+            m->keys[i] = m->keys[j];
+            m->values[i] = m->values[j];
+            i = j;
+        }
+    }
+    m->hashes[i] = 0;
+    --m->count;
+    return 1;
+}
+
+//../templates/sorted_array.adc
+
+// Array kept in sorted order, with binary search lookups.
+//
+// Bindings:
+//  name    -- array type
+//  type    -- element type
+//  less    -- C expression comparing elements `a` and `b`, e.g. "a < b" or
+//             "strcmp(a, b) < 0". It is inlined into every comparison.
+//
+// Zero-initialized arrays are empty and ready to use. Equal elements are
+// kept in insertion order.
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct SortedInts_s
+{
+    int32_t* data;
+    size_t count;
+    size_t capacity;
+} SortedInts;
+
+static inline int SortedInts_less(int32_t a, int32_t b)
+{
+    return a < b;
+}
+
+static inline void SortedInts_free(SortedInts* a)
+{
+    free(a->data);
+    a->data = NULL;
+    a->count = 0;
+    a->capacity = 0;
+}
+
+// Index of the first element that is not less than value.
+static inline size_t SortedInts_lower_bound(const SortedInts* a, int32_t value)
+{
+    size_t first = 0;
+    size_t count = a->count;
+    while (count)
+    {
+        size_t half = count / 2;
+        if (SortedInts_less(a->data[first + half], value))
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+        {
+            count = half;
+        }
+    }
+    return first;
+}
+
+// Index of the first element that is greater than value.
+static inline size_t SortedInts_upper_bound(const SortedInts* a, int32_t value)
+{
+    size_t first = 0;
+    size_t count = a->count;
+    while (count)
+    {
+        size_t half = count / 2;
+        if (!SortedInts_less(value, a->data[first + half]))
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+        {
+            count = half;
+        }
+    }
+    return first;
+}
+
+// Returns an element equal to value, or NULL.
+static inline int32_t* SortedInts_find(SortedInts* a, int32_t value)
+{
+    size_t i = SortedInts_lower_bound(a, value);
+    if (i < a->count && !SortedInts_less(value, a->data[i]))
+    {
+        return &a->data[i];
+    }
+    return NULL;
+}
+
+// Returns the index value was inserted at.
+static inline size_t SortedInts_insert(SortedInts* a, int32_t value)
+{
+    if (a->count == a->capacity)
+    {
+        a->capacity = a->capacity ? 2 * a->capacity : 16;
+        a->data = (int32_t*)realloc(a->data, a->capacity * sizeof(int32_t));
+        assert(a->data);
+    }
+    size_t i = SortedInts_upper_bound(a, value);
+    memmove(&a->data[i + 1], &a->data[i], (a->count - i) * sizeof(int32_t));
+    a->data[i] = value;
+    ++a->count;
+    return i;
+}
+
+static inline void SortedInts_remove(SortedInts* a, size_t i)
+{
+    assert(i < a->count);
+    memmove(&a->data[i], &a->data[i + 1], (a->count - i - 1) * sizeof(int32_t));
+    --a->count;
+}
+
+static inline void SortedInts_clear(SortedInts* a)
+{
+    a->count = 0;
+}
+
@@ -0,0 +1,128 @@
+// Checks the generated containers (templates/*.adc) against brute-force
+// references.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "containers.h"
+
+#define NUM_KEYS 1024
+
+static void test_array()
+{
+    FloatArray a = { 0 };
+    for (int i = 0; i < 1000; ++i)
+    {
+        FloatArray_push(&a, (float)i);
+    }
+    assert(a.count == 1000 && a.data[999] == 999.0f);
+    FloatArray_swap_remove(&a, 0);
+    assert(a.count == 999 && a.data[0] == 999.0f);
+    FloatArray_remove(&a, 0);
+    assert(a.count == 998 && a.data[0] == 1.0f && *FloatArray_last(&a) == 998.0f);
+    assert(FloatArray_pop(&a) == 998.0f);
+    float* block = FloatArray_add(&a, 10);
+    block[9] = -1.0f;
+    assert(a.count == 1007 && *FloatArray_last(&a) == -1.0f);
+    FloatArray_free(&a);
+}
+
+static void test_id_map()
+{
+    // Reference: values[id] is the value, present[id] whether it is in the map.
+    static float values[NUM_KEYS];
+    static int present[NUM_KEYS];
+    IdMap m = { 0 };
+    srand(1729);
+    for (int run = 0; run < 200000; ++run)
+    {
+        uint32_t id = (uint32_t)(rand() % NUM_KEYS);
+        switch (rand() % 3)
+        {
+            case 0:
+            {
+                float v = (float)rand();
+                assert(*IdMap_insert(&m, id, v) == v);
+                values[id] = v;
+                present[id] = 1;
+            } break;
+            case 1:
+            {
+                assert(IdMap_remove(&m, id) == present[id]);
+                present[id] = 0;
+            } break;
+            default:
+            {
+                float* v = IdMap_find(&m, id);
+                assert(present[id] ? v && *v == values[id] : !v);
+            } break;
+        }
+    }
+    size_t count = 0;
+    for (int i = 0; i < NUM_KEYS; ++i)
+    {
+        count += present[i];
+    }
+    assert(m.count == count);
+    IdMap_free(&m);
+}
+
+static void test_name_map()
+{
+    static char names[NUM_KEYS][24];
+    NameMap m = { 0 };
+    for (int i = 0; i < NUM_KEYS; ++i)
+    {
+        snprintf(names[i], sizeof(names[i]), "name_%d", i);
+        NameMap_insert(&m, names[i], i);
+    }
+    for (int i = 0; i < NUM_KEYS; ++i)
+    {
+        // Looked up by contents, not by pointer.
+        char name[24];
+        snprintf(name, sizeof(name), "name_%d", i);
+        int32_t* v = NameMap_find(&m, name);
+        assert(v && *v == i);
+    }
+    assert(!NameMap_find(&m, "name_"));
+    NameMap_free(&m);
+}
+
+static void test_sorted()
+{
+    SortedInts s = { 0 };
+    srand(42);
+    for (int i = 0; i < 5000; ++i)
+    {
+        SortedInts_insert(&s, rand() % 1000);
+    }
+    for (size_t i = 1; i < s.count; ++i)
+    {
+        assert(s.data[i - 1] <= s.data[i]);
+    }
+    for (int32_t v = 0; v < 1000; ++v)
+    {
+        int found = 0;
+        for (size_t i = 0; i < s.count; ++i)
+        {
+            found |= s.data[i] == v;
+        }
+        int32_t* p = SortedInts_find(&s, v);
+        assert(found ? p && *p == v : !p);
+    }
+    size_t before = s.count;
+    SortedInts_remove(&s, SortedInts_lower_bound(&s, s.data[0]));
+    assert(s.count == before - 1);
+    SortedInts_free(&s);
+}
+
+int main()
+{
+    test_array();
+    test_id_map();
+    test_name_map();
+    test_sorted();
+    printf("Containers match the references.\n");
+}
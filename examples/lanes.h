@@ -0,0 +1,299 @@
+//File generated from template by libserg/meta.h.
+
+//lanes.adc
+
+// Bindings:
+//  name    -- vector type
+//  type    -- component type
+//  width   -- number of components. Every loop below is unrolled for it.
+
+typedef struct f32x2_s
+{
+    float d[2];
+} f32x2;
+
+static inline f32x2 f32x2_add(f32x2 a, f32x2 b)
+{
+    f32x2 r;
+    r.d[0] = a.d[0] + b.d[0];
+    r.d[1] = a.d[1] + b.d[1];
+    return r;
+}
+
+static inline f32x2 f32x2_sub(f32x2 a, f32x2 b)
+{
+    f32x2 r;
+    r.d[0] = a.d[0] - b.d[0];
+    r.d[1] = a.d[1] - b.d[1];
+    return r;
+}
+
+static inline f32x2 f32x2_mul(f32x2 a, f32x2 b)
+{
+    f32x2 r;
+    r.d[0] = a.d[0] * b.d[0];
+    r.d[1] = a.d[1] * b.d[1];
+    return r;
+}
+
+static inline f32x2 f32x2_scale(f32x2 a, float s)
+{
+    f32x2 r;
+    r.d[0] = a.d[0] * s;
+    r.d[1] = a.d[1] * s;
+    return r;
+}
+
+// a * b + c
+static inline f32x2 f32x2_madd(f32x2 a, f32x2 b, f32x2 c)
+{
+    f32x2 r;
+    r.d[0] = a.d[0] * b.d[0] + c.d[0];
+    r.d[1] = a.d[1] * b.d[1] + c.d[1];
+    return r;
+}
+
+static inline float f32x2_dot(f32x2 a, f32x2 b)
+{
+    return a.d[0] * b.d[0] + a.d[1] * b.d[1];
+}
+
+static inline float f32x2_sum(f32x2 a)
+{
+    return a.d[0] + a.d[1];
+}
+
+//lanes.adc
+
+// Bindings:
+//  name    -- vector type
+//  type    -- component type
+//  width   -- number of components. Every loop below is unrolled for it.
+
+typedef struct f32x3_s
+{
+    float d[3];
+} f32x3;
+
+static inline f32x3 f32x3_add(f32x3 a, f32x3 b)
+{
+    f32x3 r;
+    r.d[0] = a.d[0] + b.d[0];
+    r.d[1] = a.d[1] + b.d[1];
+    r.d[2] = a.d[2] + b.d[2];
+    return r;
+}
+
+static inline f32x3 f32x3_sub(f32x3 a, f32x3 b)
+{
+    f32x3 r;
+    r.d[0] = a.d[0] - b.d[0];
+    r.d[1] = a.d[1] - b.d[1];
+    r.d[2] = a.d[2] - b.d[2];
+    return r;
+}
+
+static inline f32x3 f32x3_mul(f32x3 a, f32x3 b)
+{
+    f32x3 r;
+    r.d[0] = a.d[0] * b.d[0];
+    r.d[1] = a.d[1] * b.d[1];
+    r.d[2] = a.d[2] * b.d[2];
+    return r;
+}
+
+static inline f32x3 f32x3_scale(f32x3 a, float s)
+{
+    f32x3 r;
+    r.d[0] = a.d[0] * s;
+    r.d[1] = a.d[1] * s;
+    r.d[2] = a.d[2] * s;
+    return r;
+}
+
+// a * b + c
+static inline f32x3 f32x3_madd(f32x3 a, f32x3 b, f32x3 c)
+{
+    f32x3 r;
+    r.d[0] = a.d[0] * b.d[0] + c.d[0];
+    r.d[1] = a.d[1] * b.d[1] + c.d[1];
+    r.d[2] = a.d[2] * b.d[2] + c.d[2];
+    return r;
+}
+
+static inline float f32x3_dot(f32x3 a, f32x3 b)
+{
+    return a.d[0] * b.d[0] + a.d[1] * b.d[1] + a.d[2] * b.d[2];
+}
+
+static inline float f32x3_sum(f32x3 a)
+{
+    return a.d[0] + a.d[1] + a.d[2];
+}
+
+//lanes.adc
+
+// Bindings:
+//  name    -- vector type
+//  type    -- component type
+//  width   -- number of components. Every loop below is unrolled for it.
+
+typedef struct f32x4_s
+{
+    float d[4];
+} f32x4;
+
+static inline f32x4 f32x4_add(f32x4 a, f32x4 b)
+{
+    f32x4 r;
+    r.d[0] = a.d[0] + b.d[0];
+    r.d[1] = a.d[1] + b.d[1];
+    r.d[2] = a.d[2] + b.d[2];
+    r.d[3] = a.d[3] + b.d[3];
+    return r;
+}
+
+static inline f32x4 f32x4_sub(f32x4 a, f32x4 b)
+{
+    f32x4 r;
+    r.d[0] = a.d[0] - b.d[0];
+    r.d[1] = a.d[1] - b.d[1];
+    r.d[2] = a.d[2] - b.d[2];
+    r.d[3] = a.d[3] - b.d[3];
+    return r;
+}
+
+static inline f32x4 f32x4_mul(f32x4 a, f32x4 b)
+{
+    f32x4 r;
+    r.d[0] = a.d[0] * b.d[0];
+    r.d[1] = a.d[1] * b.d[1];
+    r.d[2] = a.d[2] * b.d[2];
+    r.d[3] = a.d[3] * b.d[3];
+    return r;
+}
+
+static inline f32x4 f32x4_scale(f32x4 a, float s)
+{
+    f32x4 r;
+    r.d[0] = a.d[0] * s;
+    r.d[1] = a.d[1] * s;
+    r.d[2] = a.d[2] * s;
+    r.d[3] = a.d[3] * s;
+    return r;
+}
+
+// a * b + c
+static inline f32x4 f32x4_madd(f32x4 a, f32x4 b, f32x4 c)
+{
+    f32x4 r;
+    r.d[0] = a.d[0] * b.d[0] + c.d[0];
+    r.d[1] = a.d[1] * b.d[1] + c.d[1];
+    r.d[2] = a.d[2] * b.d[2] + c.d[2];
+    r.d[3] = a.d[3] * b.d[3] + c.d[3];
+    return r;
+}
+
+static inline float f32x4_dot(f32x4 a, f32x4 b)
+{
+    return a.d[0] * b.d[0] + a.d[1] * b.d[1] + a.d[2] * b.d[2] + a.d[3] * b.d[3];
+}
+
+static inline float f32x4_sum(f32x4 a)
+{
+    return a.d[0] + a.d[1] + a.d[2] + a.d[3];
+}
+
+//lanes.adc
+
+// Bindings:
+//  name    -- vector type
+//  type    -- component type
+//  width   -- number of components. Every loop below is unrolled for it.
+
+typedef struct f32x8_s
+{
+    float d[8];
+} f32x8;
+
+static inline f32x8 f32x8_add(f32x8 a, f32x8 b)
+{
+    f32x8 r;
+    r.d[0] = a.d[0] + b.d[0];
+    r.d[1] = a.d[1] + b.d[1];
+    r.d[2] = a.d[2] + b.d[2];
+    r.d[3] = a.d[3] + b.d[3];
+    r.d[4] = a.d[4] + b.d[4];
+    r.d[5] = a.d[5] + b.d[5];
+    r.d[6] = a.d[6] + b.d[6];
+    r.d[7] = a.d[7] + b.d[7];
+    return r;
+}
+
+static inline f32x8 f32x8_sub(f32x8 a, f32x8 b)
+{
+    f32x8 r;
+    r.d[0] = a.d[0] - b.d[0];
+    r.d[1] = a.d[1] - b.d[1];
+    r.d[2] = a.d[2] - b.d[2];
+    r.d[3] = a.d[3] - b.d[3];
+    r.d[4] = a.d[4] - b.d[4];
+    r.d[5] = a.d[5] - b.d[5];
+    r.d[6] = a.d[6] - b.d[6];
+    r.d[7] = a.d[7] - b.d[7];
+    return r;
+}
+
+static inline f32x8 f32x8_mul(f32x8 a, f32x8 b)
+{
+    f32x8 r;
+    r.d[0] = a.d[0] * b.d[0];
+    r.d[1] = a.d[1] * b.d[1];
+    r.d[2] = a.d[2] * b.d[2];
+    r.d[3] = a.d[3] * b.d[3];
+    r.d[4] = a.d[4] * b.d[4];
+    r.d[5] = a.d[5] * b.d[5];
+    r.d[6] = a.d[6] * b.d[6];
+    r.d[7] = a.d[7] * b.d[7];
+    return r;
+}
+
+static inline f32x8 f32x8_scale(f32x8 a, float s)
+{
+    f32x8 r;
+    r.d[0] = a.d[0] * s;
+    r.d[1] = a.d[1] * s;
+    r.d[2] = a.d[2] * s;
+    r.d[3] = a.d[3] * s;
+    r.d[4] = a.d[4] * s;
+    r.d[5] = a.d[5] * s;
+    r.d[6] = a.d[6] * s;
+    r.d[7] = a.d[7] * s;
+    return r;
+}
+
+// a * b + c
+static inline f32x8 f32x8_madd(f32x8 a, f32x8 b, f32x8 c)
+{
+    f32x8 r;
+    r.d[0] = a.d[0] * b.d[0] + c.d[0];
+    r.d[1] = a.d[1] * b.d[1] + c.d[1];
+    r.d[2] = a.d[2] * b.d[2] + c.d[2];
+    r.d[3] = a.d[3] * b.d[3] + c.d[3];
+    r.d[4] = a.d[4] * b.d[4] + c.d[4];
+    r.d[5] = a.d[5] * b.d[5] + c.d[5];
+    r.d[6] = a.d[6] * b.d[6] + c.d[6];
+    r.d[7] = a.d[7] * b.d[7] + c.d[7];
+    return r;
+}
+
+static inline float f32x8_dot(f32x8 a, f32x8 b)
+{
+    return a.d[0] * b.d[0] + a.d[1] * b.d[1] + a.d[2] * b.d[2] + a.d[3] * b.d[3] + a.d[4] * b.d[4] + a.d[5] * b.d[5] + a.d[6] * b.d[6] + a.d[7] * b.d[7];
+}
+
+static inline float f32x8_sum(f32x8 a)
+{
+    return a.d[0] + a.d[1] + a.d[2] + a.d[3] + a.d[4] + a.d[5] + a.d[6] + a.d[7];
+}
+
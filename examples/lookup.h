@@ -0,0 +1,178 @@
+//File generated from template by libserg/meta.h.
+
+//Perfect hash: EmitterShape, 4 strings
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define EmitterShape_COUNT 4
+
+static const char* const EmitterShape_strings[4] =
+{
+    "EMITTER_POINT",
+    "EMITTER_SPHERE",
+    "EMITTER_CONE",
+    "EMITTER_BOX",
+};
+
+static const uint8_t EmitterShape_lengths[4] =
+{
+    13, 14, 12, 11,
+};
+
+static const uint8_t EmitterShape_seeds[3] =
+{
+    2, 0, 5,
+};
+
+static const uint8_t EmitterShape_slots[4] =
+{
+    0, 3, 2, 1,
+};
+
+static inline uint32_t EmitterShape_mix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Returns the index of str in EmitterShape_strings, or -1 if it isn't one of them.
+static inline int EmitterShape_lookup(const char* str, size_t len)
+{
+    uint32_t h = 2166136261u ^ 0u;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+    h = EmitterShape_mix(h);
+    int i = (int)EmitterShape_slots[EmitterShape_mix(h ^ EmitterShape_seeds[h % 3u]) % 4u];
+    return (len == EmitterShape_lengths[i] && !memcmp(str, EmitterShape_strings[i], len)) ? i : -1;
+}
+
+static const EmitterShape EmitterShape_values[4] =
+{
+    EMITTER_POINT,
+    EMITTER_SPHERE,
+    EMITTER_CONE,
+    EMITTER_BOX,
+};
+
+// NULL if value isn't one of the enumerators.
+static inline const char* EmitterShape_to_string(EmitterShape value)
+{
+    return (unsigned long long)value < 4u ? EmitterShape_strings[(int)value] : NULL;
+}
+
+// Returns 0 and leaves value alone if str isn't the name of an enumerator.
+static inline int EmitterShape_from_string(const char* str, size_t len, EmitterShape* value)
+{
+    int i = EmitterShape_lookup(str, len);
+    if (i < 0)
+    {
+        return 0;
+    }
+    *value = EmitterShape_values[i];
+    return 1;
+}
+
+//Perfect hash: CKeyword, 37 strings
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CKeyword_COUNT 37
+
+static const char* const CKeyword_strings[37] =
+{
+    "auto",
+    "break",
+    "case",
+    "char",
+    "const",
+    "continue",
+    "default",
+    "do",
+    "double",
+    "else",
+    "enum",
+    "extern",
+    "float",
+    "for",
+    "goto",
+    "if",
+    "inline",
+    "int",
+    "long",
+    "register",
+    "restrict",
+    "return",
+    "short",
+    "signed",
+    "sizeof",
+    "static",
+    "struct",
+    "switch",
+    "typedef",
+    "union",
+    "unsigned",
+    "void",
+    "volatile",
+    "while",
+    "_Bool",
+    "_Complex",
+    "_Imaginary",
+};
+
+static const uint8_t CKeyword_lengths[37] =
+{
+    4, 5, 4, 4, 5, 8, 7, 2, 6, 4, 4, 6,
+    5, 3, 4, 2, 6, 3, 4, 8, 8, 6, 5, 6,
+    6, 6, 6, 6, 7, 5, 8, 4, 8, 5, 5, 8,
+    10,
+};
+
+static const uint8_t CKeyword_seeds[19] =
+{
+    0, 0, 0, 0, 2, 12, 0, 16, 5, 0, 2, 0,
+    80, 4, 48, 3, 9, 49, 14,
+};
+
+static const uint8_t CKeyword_slots[37] =
+{
+    9, 34, 24, 16, 8, 13, 17, 4, 31, 25, 36, 5,
+    21, 7, 33, 26, 27, 1, 22, 19, 29, 15, 23, 11,
+    28, 10, 32, 35, 0, 20, 12, 2, 14, 6, 3, 18,
+    30,
+};
+
+static inline uint32_t CKeyword_mix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Returns the index of str in CKeyword_strings, or -1 if it isn't one of them.
+static inline int CKeyword_lookup(const char* str, size_t len)
+{
+    uint32_t h = 2166136261u ^ 0u;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+    h = CKeyword_mix(h);
+    int i = (int)CKeyword_slots[CKeyword_mix(h ^ CKeyword_seeds[h % 19u]) % 37u];
+    return (len == CKeyword_lengths[i] && !memcmp(str, CKeyword_strings[i], len)) ? i : -1;
+}
+
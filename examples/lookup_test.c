@@ -0,0 +1,74 @@
+// Checks the generated string lookups (lookup.h) against a linear search:
+// every name is found at its own index, and near misses aren't found.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "particle.h"
+#include "lookup.h"
+
+static int linear_search(const char* const* strings, int count, const char* str, size_t len)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (strlen(strings[i]) == len && !memcmp(strings[i], str, len))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main()
+{
+    for (int i = 0; i < CKeyword_COUNT; ++i)
+    {
+        const char* keyword = CKeyword_strings[i];
+        size_t len = strlen(keyword);
+        assert(CKeyword_lookup(keyword, len) == i);
+        // Prefixes and one changed character.
+        char near[32];
+        memcpy(near, keyword, len);
+        for (size_t c = 0; c < len; ++c)
+        {
+            assert(CKeyword_lookup(keyword, c) == linear_search(CKeyword_strings, CKeyword_COUNT, keyword, c));
+            near[c] ^= 0x20;
+            assert(CKeyword_lookup(near, len) == linear_search(CKeyword_strings, CKeyword_COUNT, near, len));
+            near[c] ^= 0x20;
+        }
+    }
+
+    srand(1729);
+    for (int run = 0; run < 100000; ++run)
+    {
+        char str[12];
+        size_t len = (size_t)(rand() % (int)sizeof(str));
+        for (size_t c = 0; c < len; ++c)
+        {
+            str[c] = "aeiou_BdnrstC"[rand() % 13];
+        }
+        assert(CKeyword_lookup(str, len) == linear_search(CKeyword_strings, CKeyword_COUNT, str, len));
+    }
+
+    EmitterShape shapes[] = { EMITTER_POINT, EMITTER_SPHERE, EMITTER_CONE, EMITTER_BOX };
+    for (int i = 0; i < 4; ++i)
+    {
+        const char* name = EmitterShape_to_string(shapes[i]);
+        assert(name && !strcmp(name, EmitterShape_strings[i]));
+        EmitterShape shape = EMITTER_POINT;
+        assert(EmitterShape_from_string(name, strlen(name), &shape) && shape == shapes[i]);
+    }
+    assert(!strcmp(EmitterShape_to_string(EMITTER_CONE), "EMITTER_CONE"));
+    assert(EmitterShape_to_string((EmitterShape)4) == NULL);
+    assert(EmitterShape_to_string((EmitterShape)-1) == NULL);
+
+    EmitterShape shape = EMITTER_BOX;
+    assert(!EmitterShape_from_string("EMITTER_", 8, &shape) && shape == EMITTER_BOX);
+    assert(!EmitterShape_from_string("emitter_box", 11, &shape) && shape == EMITTER_BOX);
+    assert(!EmitterShape_from_string("", 0, &shape));
+
+    printf("String lookups match a linear search.\n");
+}
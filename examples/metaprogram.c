@@ -1,25 +1,132 @@
 #include "../meta.h"
 
-int main()
+// Built with -DEMBED_TEMPLATES, the templates are read from the header
+// written by `metaprogram --embed` instead of from disk.
+#if defined(EMBED_TEMPLATES)
+#include "embedded_templates.h"
+#endif
+
+static const char* templates[] =
+{
+    "vector.adc",
+    "vector_ops.adc",
+    "lanes.adc",
+    "../templates/array.adc",
+    "../templates/hash_map.adc",
+    "../templates/sorted_array.adc",
+};
+
+int main(int argc, char** argv)
 {
+    if (argc > 1 && !strcmp(argv[1], "--embed"))
+    {
+        int num_templates = (int)(sizeof(templates) / sizeof(templates[0]));
+        return meta_embed_templates("embedded_templates.h", templates, num_templates, NULL) < 0;
+    }
+#if defined(EMBED_TEMPLATES)
+    meta_register_templates(meta_embedded_templates, META_NUM_EMBEDDED_TEMPLATES);
+#endif
+
     meta_clear_file("vector.h");
-    meta_expand(
-            "vector.h",
-            "vector.adc",
-            3,  // Number of bindings
-            // Bindings:
-            "name_2", "v2f",
-            "name_3", "v3f",
-            "type", "float");
-
-    meta_expand(
-            "vector.h",
-            "vector.adc",
-            3,  // Number of bindings
-            // Bindings:
-            "name_2", "v2i",
-            "name_3", "v3i",
-            "type", "int32_t");
+
+    // Parse the templates once, render them for every type in one pass.
+    MetaTemplate* vector_tmpl = meta_template_compile("vector.adc");
+    MetaTemplate* vector_ops_tmpl = meta_template_compile("vector_ops.adc");
+
+    MetaBinding vf[] =
+    {
+        { "name_2", "v2f" },
+        { "name_3", "v3f" },
+        { "type", "float" },
+        { "is_float", "1" },
+    };
+    MetaBinding vi[] =
+    {
+        { "name_2", "v2i" },
+        { "name_3", "v3i" },
+        { "type", "int32_t" },
+        { "is_float", "0" },
+    };
+    MetaBindingSet vector_types[] =
+    {
+        { vf, 4 },
+        { vi, 4 },
+    };
+
+    MetaSink sink;
+    meta_sink_file(&sink, "vector.h");
+    meta_template_render_batch(vector_tmpl, &sink, vector_types, 2);
+    meta_template_render_batch(vector_ops_tmpl, &sink, vector_types, 2);
+    meta_sink_close(&sink);
+
+    meta_template_free(vector_tmpl);
+    meta_template_free(vector_ops_tmpl);
+
+    // Fixed-width vectors, fully unrolled for each width.
+    meta_clear_file("lanes.h");
+    MetaTemplate* lanes_tmpl = meta_template_compile("lanes.adc");
+    MetaBinding f32x2[] = { { "name", "f32x2" }, { "type", "float" }, { "width", "2" } };
+    MetaBinding f32x3[] = { { "name", "f32x3" }, { "type", "float" }, { "width", "3" } };
+    MetaBinding f32x4[] = { { "name", "f32x4" }, { "type", "float" }, { "width", "4" } };
+    MetaBinding f32x8[] = { { "name", "f32x8" }, { "type", "float" }, { "width", "8" } };
+    MetaBindingSet lane_types[] =
+    {
+        { f32x2, 3 },
+        { f32x3, 3 },
+        { f32x4, 3 },
+        { f32x8, 3 },
+    };
+    meta_sink_file(&sink, "lanes.h");
+    meta_template_render_batch(lanes_tmpl, &sink, lane_types, 4);
+    meta_sink_close(&sink);
+    meta_template_free(lanes_tmpl);
+
+    // Containers specialized for their element types.
+    meta_clear_file("containers.h");
+    meta_expand("containers.h", "../templates/array.adc", 2,
+                "name", "FloatArray",
+                "type", "float");
+    meta_expand("containers.h", "../templates/hash_map.adc", 4,
+                "name", "NameMap",
+                "key", "const char*",
+                "value", "int32_t",
+                "key_is_string", "1");
+    meta_expand("containers.h", "../templates/hash_map.adc", 4,
+                "name", "IdMap",
+                "key", "uint32_t",
+                "value", "float",
+                "key_is_string", "0");
+    meta_expand("containers.h", "../templates/sorted_array.adc", 3,
+                "name", "SortedInts",
+                "type", "int32_t",
+                "less", "a < b");
+
+    // Structure-of-arrays container for the Particle struct.
+    meta_clear_file("particle_soa.h");
+    meta_soa("particle_soa.h", "particle.h", "Particle");
+
+    // Sizes, offsets and padding of the structs in particle.h, checked at
+    // compile time.
+    meta_clear_file("particle_layout.h");
+    meta_struct_layout_report("particle_layout.h", "particle.h");
+
+    // Binary read/write for the structs in particle.h that have no pointers.
+    meta_clear_file("particle_serial.h");
+    meta_serial("particle_serial.h", "particle.h", NULL);
+
+    // Names of the enums in particle.h, and the C keywords, with perfect hash
+    // lookups from string.
+    static const char* c_keywords[] =
+    {
+        "auto", "break", "case", "char", "const", "continue", "default", "do",
+        "double", "else", "enum", "extern", "float", "for", "goto", "if",
+        "inline", "int", "long", "register", "restrict", "return", "short", "signed",
+        "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void",
+        "volatile", "while", "_Bool", "_Complex", "_Imaginary",
+    };
+    meta_clear_file("lookup.h");
+    meta_enum_strings("lookup.h", "particle.h", NULL);
+    meta_perfect_hash("lookup.h", "CKeyword", c_keywords, (int)(sizeof(c_keywords) / sizeof(c_keywords[0])));
 
     //meta_type_info( "./dummy_project/types.h", "./dummy_project");
 }
@@ -0,0 +1,43 @@
+#pragma once
+
+typedef enum
+{
+    EMITTER_POINT,
+    EMITTER_SPHERE,
+    EMITTER_CONE,
+    EMITTER_BOX,
+} EmitterShape;
+
+typedef struct
+{
+    float   position[3];
+    float   velocity[3];
+    float   mass;
+    int32_t flags;
+} Particle;
+
+// Fields in the order they were added. particle_layout.h shows the holes.
+typedef struct
+{
+    uint8_t     active;
+    double      rate;       // Particles per second
+    uint16_t    max_particles;
+    float       spread;
+    Particle*   pool;
+    uint8_t     shape;      // EmitterShape
+    Particle    prototype;
+} ParticleEmitter;
+
+typedef struct
+{
+    uint8_t     count;
+    double      time;
+} EmitterBurst;
+
+// Serialized with zeros over the holes, those inside the bursts too.
+typedef struct
+{
+    uint32_t        id;
+    EmitterBurst    bursts[2];
+    uint8_t         looped;
+} EmitterSchedule;
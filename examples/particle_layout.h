@@ -0,0 +1,71 @@
+//File generated from template by libserg/meta.h.
+
+// Struct layouts on x86-64 System V.
+
+#include <stddef.h>
+
+// Particle: 32 bytes, align 4, 0 bytes of padding
+//     offset   size  align  field
+//          0     12      4  position
+//         12     12      4  velocity
+//         24      4      4  mass
+//         28      4      4  flags
+#if defined(__x86_64__) && !defined(_WIN32)
+_Static_assert(sizeof(Particle) == 32, "Particle: size changed");
+_Static_assert(offsetof(Particle, position) == 0, "Particle: position moved");
+_Static_assert(offsetof(Particle, velocity) == 12, "Particle: velocity moved");
+_Static_assert(offsetof(Particle, mass) == 24, "Particle: mass moved");
+_Static_assert(offsetof(Particle, flags) == 28, "Particle: flags moved");
+#endif
+
+// ParticleEmitter: 72 bytes, align 8, 16 bytes of padding, 1 field straddling cache lines
+//     offset   size  align  field
+//          0      1      1  active
+//          1      7         (padding)
+//          8      8      8  rate
+//         16      2      2  max_particles
+//         18      2         (padding)
+//         20      4      4  spread
+//         24      8      8  pool
+//         32      1      1  shape
+//         33      3         (padding)
+//         36     32      4  prototype  (straddles a cache line)
+//         68      4         (padding)
+// Suggested order, 56 bytes (16 less), 0 straddling: rate, pool, spread, prototype, max_particles, active, shape
+#if defined(__x86_64__) && !defined(_WIN32)
+_Static_assert(sizeof(ParticleEmitter) == 72, "ParticleEmitter: size changed");
+_Static_assert(offsetof(ParticleEmitter, active) == 0, "ParticleEmitter: active moved");
+_Static_assert(offsetof(ParticleEmitter, rate) == 8, "ParticleEmitter: rate moved");
+_Static_assert(offsetof(ParticleEmitter, max_particles) == 16, "ParticleEmitter: max_particles moved");
+_Static_assert(offsetof(ParticleEmitter, spread) == 20, "ParticleEmitter: spread moved");
+_Static_assert(offsetof(ParticleEmitter, pool) == 24, "ParticleEmitter: pool moved");
+_Static_assert(offsetof(ParticleEmitter, shape) == 32, "ParticleEmitter: shape moved");
+_Static_assert(offsetof(ParticleEmitter, prototype) == 36, "ParticleEmitter: prototype moved");
+#endif
+
+// EmitterBurst: 16 bytes, align 8, 7 bytes of padding
+//     offset   size  align  field
+//          0      1      1  count
+//          1      7         (padding)
+//          8      8      8  time
+#if defined(__x86_64__) && !defined(_WIN32)
+_Static_assert(sizeof(EmitterBurst) == 16, "EmitterBurst: size changed");
+_Static_assert(offsetof(EmitterBurst, count) == 0, "EmitterBurst: count moved");
+_Static_assert(offsetof(EmitterBurst, time) == 8, "EmitterBurst: time moved");
+#endif
+
+// EmitterSchedule: 48 bytes, align 8, 11 bytes of padding
+//     offset   size  align  field
+//          0      4      4  id
+//          4      4         (padding)
+//          8     32      8  bursts
+//         40      1      1  looped
+//         41      7         (padding)
+// Suggested order, 40 bytes (8 less), 0 straddling: bursts, id, looped
+#if defined(__x86_64__) && !defined(_WIN32)
+_Static_assert(sizeof(EmitterSchedule) == 48, "EmitterSchedule: size changed");
+_Static_assert(offsetof(EmitterSchedule, id) == 0, "EmitterSchedule: id moved");
+_Static_assert(offsetof(EmitterSchedule, bursts) == 8, "EmitterSchedule: bursts moved");
+_Static_assert(offsetof(EmitterSchedule, looped) == 40, "EmitterSchedule: looped moved");
+#endif
+
@@ -0,0 +1,326 @@
+//File generated from template by libserg/meta.h.
+
+//Serialization: Particle
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define Particle_SCHEMA 0x9b0e73b624542cf3ull
+#define Particle_SERIAL_HEADER_SIZE 32
+#define Particle_SERIAL_ALIGN 4
+
+#if defined(__x86_64__) && !defined(_WIN32)
+_Static_assert(sizeof(Particle) == 32, "Particle: size changed");
+_Static_assert(offsetof(Particle, position) == 0, "Particle: position moved");
+_Static_assert(offsetof(Particle, velocity) == 12, "Particle: velocity moved");
+_Static_assert(offsetof(Particle, mass) == 24, "Particle: mass moved");
+_Static_assert(offsetof(Particle, flags) == 28, "Particle: flags moved");
+#endif
+
+static inline size_t Particle_serial_size(size_t count)
+{
+    return Particle_SERIAL_HEADER_SIZE + count * sizeof(Particle);
+}
+
+// `buffer` needs Particle_serial_size(count) bytes.
+static inline void Particle_serial_write(void* buffer, const Particle* values, size_t count)
+{
+    unsigned char* out = (unsigned char*)buffer;
+    uint32_t element_size = (uint32_t)sizeof(Particle);
+    uint64_t schema = Particle_SCHEMA;
+    uint64_t count64 = (uint64_t)count;
+    uint32_t header_size = Particle_SERIAL_HEADER_SIZE;
+    memset(out, 0, Particle_SERIAL_HEADER_SIZE);
+    memcpy(out, "ADCS", 4);
+    memcpy(out + 4, &element_size, 4);
+    memcpy(out + 8, &schema, 8);
+    memcpy(out + 16, &count64, 8);
+    memcpy(out + 24, &header_size, 4);
+    if (!count)
+    {
+        return;
+    }
+    size_t field_bytes = (sizeof(((Particle*)0)->position) + sizeof(((Particle*)0)->velocity) + sizeof(((Particle*)0)->mass) + sizeof(((Particle*)0)->flags));
+    if (field_bytes == sizeof(Particle))
+    {
+        memcpy(out + Particle_SERIAL_HEADER_SIZE, values, count * sizeof(Particle));
+        return;
+    }
+    memset(out + Particle_SERIAL_HEADER_SIZE, 0, count * sizeof(Particle));
+    for (size_t i = 0; i < count; ++i)
+    {
+        unsigned char* element = out + Particle_SERIAL_HEADER_SIZE + i * sizeof(Particle);
+        memcpy(element + offsetof(Particle, position), &values[i].position, sizeof(values[i].position));
+        memcpy(element + offsetof(Particle, velocity), &values[i].velocity, sizeof(values[i].velocity));
+        memcpy(element + offsetof(Particle, mass), &values[i].mass, sizeof(values[i].mass));
+        memcpy(element + offsetof(Particle, flags), &values[i].flags, sizeof(values[i].flags));
+    }
+}
+
+// Returns the number of elements in a buffer written by Particle_serial_write,
+// or (size_t)-1 if it is damaged or has another layout.
+static inline size_t Particle_serial_count(const void* buffer, size_t size)
+{
+    const unsigned char* in = (const unsigned char*)buffer;
+    uint32_t element_size, header_size;
+    uint64_t schema, count;
+    if (size < Particle_SERIAL_HEADER_SIZE || memcmp(in, "ADCS", 4))
+    {
+        return (size_t)-1;
+    }
+    memcpy(&element_size, in + 4, 4);
+    memcpy(&schema, in + 8, 8);
+    memcpy(&count, in + 16, 8);
+    memcpy(&header_size, in + 24, 4);
+    if (element_size != sizeof(Particle) || schema != Particle_SCHEMA || header_size != Particle_SERIAL_HEADER_SIZE ||
+        count > (size - Particle_SERIAL_HEADER_SIZE) / sizeof(Particle))
+    {
+        return (size_t)-1;
+    }
+    return (size_t)count;
+}
+
+// The elements, in place. NULL if _count fails or the buffer isn't aligned
+// for Particle; then _read still works.
+static inline const Particle* Particle_serial_view(const void* buffer, size_t size, size_t* count)
+{
+    size_t n = Particle_serial_count(buffer, size);
+    const unsigned char* values = (const unsigned char*)buffer + Particle_SERIAL_HEADER_SIZE;
+    if (n == (size_t)-1 || (uintptr_t)values % Particle_SERIAL_ALIGN)
+    {
+        return NULL;
+    }
+    *count = n;
+    return (const Particle*)values;
+}
+
+// Copies up to max_count elements out. Returns how many there are, or
+// (size_t)-1 like _count.
+static inline size_t Particle_serial_read(const void* buffer, size_t size, Particle* values, size_t max_count)
+{
+    size_t n = Particle_serial_count(buffer, size);
+    if (n != (size_t)-1 && n)
+    {
+        memcpy(values, (const unsigned char*)buffer + Particle_SERIAL_HEADER_SIZE,
+               (n < max_count ? n : max_count) * sizeof(Particle));
+    }
+    return n;
+}
+
+//Serialization: EmitterBurst
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define EmitterBurst_SCHEMA 0x96a8666a1ddfaa09ull
+#define EmitterBurst_SERIAL_HEADER_SIZE 32
+#define EmitterBurst_SERIAL_ALIGN 8
+
+#if defined(__x86_64__) && !defined(_WIN32)
+_Static_assert(sizeof(EmitterBurst) == 16, "EmitterBurst: size changed");
+_Static_assert(offsetof(EmitterBurst, count) == 0, "EmitterBurst: count moved");
+_Static_assert(offsetof(EmitterBurst, time) == 8, "EmitterBurst: time moved");
+#endif
+
+static inline size_t EmitterBurst_serial_size(size_t count)
+{
+    return EmitterBurst_SERIAL_HEADER_SIZE + count * sizeof(EmitterBurst);
+}
+
+// `buffer` needs EmitterBurst_serial_size(count) bytes.
+static inline void EmitterBurst_serial_write(void* buffer, const EmitterBurst* values, size_t count)
+{
+    unsigned char* out = (unsigned char*)buffer;
+    uint32_t element_size = (uint32_t)sizeof(EmitterBurst);
+    uint64_t schema = EmitterBurst_SCHEMA;
+    uint64_t count64 = (uint64_t)count;
+    uint32_t header_size = EmitterBurst_SERIAL_HEADER_SIZE;
+    memset(out, 0, EmitterBurst_SERIAL_HEADER_SIZE);
+    memcpy(out, "ADCS", 4);
+    memcpy(out + 4, &element_size, 4);
+    memcpy(out + 8, &schema, 8);
+    memcpy(out + 16, &count64, 8);
+    memcpy(out + 24, &header_size, 4);
+    if (!count)
+    {
+        return;
+    }
+    size_t field_bytes = (sizeof(((EmitterBurst*)0)->count) + sizeof(((EmitterBurst*)0)->time));
+    if (field_bytes == sizeof(EmitterBurst))
+    {
+        memcpy(out + EmitterBurst_SERIAL_HEADER_SIZE, values, count * sizeof(EmitterBurst));
+        return;
+    }
+    memset(out + EmitterBurst_SERIAL_HEADER_SIZE, 0, count * sizeof(EmitterBurst));
+    for (size_t i = 0; i < count; ++i)
+    {
+        unsigned char* element = out + EmitterBurst_SERIAL_HEADER_SIZE + i * sizeof(EmitterBurst);
+        memcpy(element + offsetof(EmitterBurst, count), &values[i].count, sizeof(values[i].count));
+        memcpy(element + offsetof(EmitterBurst, time), &values[i].time, sizeof(values[i].time));
+    }
+}
+
+// Returns the number of elements in a buffer written by EmitterBurst_serial_write,
+// or (size_t)-1 if it is damaged or has another layout.
+static inline size_t EmitterBurst_serial_count(const void* buffer, size_t size)
+{
+    const unsigned char* in = (const unsigned char*)buffer;
+    uint32_t element_size, header_size;
+    uint64_t schema, count;
+    if (size < EmitterBurst_SERIAL_HEADER_SIZE || memcmp(in, "ADCS", 4))
+    {
+        return (size_t)-1;
+    }
+    memcpy(&element_size, in + 4, 4);
+    memcpy(&schema, in + 8, 8);
+    memcpy(&count, in + 16, 8);
+    memcpy(&header_size, in + 24, 4);
+    if (element_size != sizeof(EmitterBurst) || schema != EmitterBurst_SCHEMA || header_size != EmitterBurst_SERIAL_HEADER_SIZE ||
+        count > (size - EmitterBurst_SERIAL_HEADER_SIZE) / sizeof(EmitterBurst))
+    {
+        return (size_t)-1;
+    }
+    return (size_t)count;
+}
+
+// The elements, in place. NULL if _count fails or the buffer isn't aligned
+// for EmitterBurst; then _read still works.
+static inline const EmitterBurst* EmitterBurst_serial_view(const void* buffer, size_t size, size_t* count)
+{
+    size_t n = EmitterBurst_serial_count(buffer, size);
+    const unsigned char* values = (const unsigned char*)buffer + EmitterBurst_SERIAL_HEADER_SIZE;
+    if (n == (size_t)-1 || (uintptr_t)values % EmitterBurst_SERIAL_ALIGN)
+    {
+        return NULL;
+    }
+    *count = n;
+    return (const EmitterBurst*)values;
+}
+
+// Copies up to max_count elements out. Returns how many there are, or
+// (size_t)-1 like _count.
+static inline size_t EmitterBurst_serial_read(const void* buffer, size_t size, EmitterBurst* values, size_t max_count)
+{
+    size_t n = EmitterBurst_serial_count(buffer, size);
+    if (n != (size_t)-1 && n)
+    {
+        memcpy(values, (const unsigned char*)buffer + EmitterBurst_SERIAL_HEADER_SIZE,
+               (n < max_count ? n : max_count) * sizeof(EmitterBurst));
+    }
+    return n;
+}
+
+//Serialization: EmitterSchedule
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define EmitterSchedule_SCHEMA 0x11e01da91d112554ull
+#define EmitterSchedule_SERIAL_HEADER_SIZE 32
+#define EmitterSchedule_SERIAL_ALIGN 8
+
+#if defined(__x86_64__) && !defined(_WIN32)
+_Static_assert(sizeof(EmitterSchedule) == 48, "EmitterSchedule: size changed");
+_Static_assert(offsetof(EmitterSchedule, id) == 0, "EmitterSchedule: id moved");
+_Static_assert(offsetof(EmitterSchedule, bursts) == 8, "EmitterSchedule: bursts moved");
+_Static_assert(offsetof(EmitterSchedule, looped) == 40, "EmitterSchedule: looped moved");
+#endif
+
+static inline size_t EmitterSchedule_serial_size(size_t count)
+{
+    return EmitterSchedule_SERIAL_HEADER_SIZE + count * sizeof(EmitterSchedule);
+}
+
+// `buffer` needs EmitterSchedule_serial_size(count) bytes.
+static inline void EmitterSchedule_serial_write(void* buffer, const EmitterSchedule* values, size_t count)
+{
+    unsigned char* out = (unsigned char*)buffer;
+    uint32_t element_size = (uint32_t)sizeof(EmitterSchedule);
+    uint64_t schema = EmitterSchedule_SCHEMA;
+    uint64_t count64 = (uint64_t)count;
+    uint32_t header_size = EmitterSchedule_SERIAL_HEADER_SIZE;
+    memset(out, 0, EmitterSchedule_SERIAL_HEADER_SIZE);
+    memcpy(out, "ADCS", 4);
+    memcpy(out + 4, &element_size, 4);
+    memcpy(out + 8, &schema, 8);
+    memcpy(out + 16, &count64, 8);
+    memcpy(out + 24, &header_size, 4);
+    if (!count)
+    {
+        return;
+    }
+    size_t field_bytes = (sizeof(((EmitterSchedule*)0)->id) + sizeof(((EmitterSchedule*)0)->bursts) / sizeof(EmitterBurst) * (sizeof(((EmitterBurst*)0)->count) + sizeof(((EmitterBurst*)0)->time)) + sizeof(((EmitterSchedule*)0)->looped));
+    if (field_bytes == sizeof(EmitterSchedule))
+    {
+        memcpy(out + EmitterSchedule_SERIAL_HEADER_SIZE, values, count * sizeof(EmitterSchedule));
+        return;
+    }
+    memset(out + EmitterSchedule_SERIAL_HEADER_SIZE, 0, count * sizeof(EmitterSchedule));
+    for (size_t i = 0; i < count; ++i)
+    {
+        unsigned char* element = out + EmitterSchedule_SERIAL_HEADER_SIZE + i * sizeof(EmitterSchedule);
+        memcpy(element + offsetof(EmitterSchedule, id), &values[i].id, sizeof(values[i].id));
+        for (size_t j0 = 0; j0 < sizeof(values[i].bursts) / sizeof(EmitterBurst); ++j0)
+        {
+            unsigned char* out0 = element + offsetof(EmitterSchedule, bursts) + j0 * sizeof(EmitterBurst);
+            const EmitterBurst* in0 = (const EmitterBurst*)&values[i].bursts + j0;
+            memcpy(out0 + offsetof(EmitterBurst, count), &in0->count, sizeof(in0->count));
+            memcpy(out0 + offsetof(EmitterBurst, time), &in0->time, sizeof(in0->time));
+        }
+        memcpy(element + offsetof(EmitterSchedule, looped), &values[i].looped, sizeof(values[i].looped));
+    }
+}
+
+// Returns the number of elements in a buffer written by EmitterSchedule_serial_write,
+// or (size_t)-1 if it is damaged or has another layout.
+static inline size_t EmitterSchedule_serial_count(const void* buffer, size_t size)
+{
+    const unsigned char* in = (const unsigned char*)buffer;
+    uint32_t element_size, header_size;
+    uint64_t schema, count;
+    if (size < EmitterSchedule_SERIAL_HEADER_SIZE || memcmp(in, "ADCS", 4))
+    {
+        return (size_t)-1;
+    }
+    memcpy(&element_size, in + 4, 4);
+    memcpy(&schema, in + 8, 8);
+    memcpy(&count, in + 16, 8);
+    memcpy(&header_size, in + 24, 4);
+    if (element_size != sizeof(EmitterSchedule) || schema != EmitterSchedule_SCHEMA || header_size != EmitterSchedule_SERIAL_HEADER_SIZE ||
+        count > (size - EmitterSchedule_SERIAL_HEADER_SIZE) / sizeof(EmitterSchedule))
+    {
+        return (size_t)-1;
+    }
+    return (size_t)count;
+}
+
+// The elements, in place. NULL if _count fails or the buffer isn't aligned
+// for EmitterSchedule; then _read still works.
+static inline const EmitterSchedule* EmitterSchedule_serial_view(const void* buffer, size_t size, size_t* count)
+{
+    size_t n = EmitterSchedule_serial_count(buffer, size);
+    const unsigned char* values = (const unsigned char*)buffer + EmitterSchedule_SERIAL_HEADER_SIZE;
+    if (n == (size_t)-1 || (uintptr_t)values % EmitterSchedule_SERIAL_ALIGN)
+    {
+        return NULL;
+    }
+    *count = n;
+    return (const EmitterSchedule*)values;
+}
+
+// Copies up to max_count elements out. Returns how many there are, or
+// (size_t)-1 like _count.
+static inline size_t EmitterSchedule_serial_read(const void* buffer, size_t size, EmitterSchedule* values, size_t max_count)
+{
+    size_t n = EmitterSchedule_serial_count(buffer, size);
+    if (n != (size_t)-1 && n)
+    {
+        memcpy(values, (const unsigned char*)buffer + EmitterSchedule_SERIAL_HEADER_SIZE,
+               (n < max_count ? n : max_count) * sizeof(EmitterSchedule));
+    }
+    return n;
+}
+
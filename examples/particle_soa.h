@@ -0,0 +1,127 @@
+//File generated from template by libserg/meta.h.
+
+//SoA: Particle
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    size_t count;
+    size_t capacity;
+    void* block;  // All the arrays live in this allocation
+
+    float (*position)[3];
+    float (*velocity)[3];
+    float* mass;
+    int32_t* flags;
+} ParticleSoA;
+
+static inline void ParticleSoA_init(ParticleSoA* soa)
+{
+    memset(soa, 0, sizeof(ParticleSoA));
+}
+
+static inline void ParticleSoA_free(ParticleSoA* soa)
+{
+    free(soa->block);
+    memset(soa, 0, sizeof(ParticleSoA));
+}
+
+// Returns 0 when out of memory.
+static inline int ParticleSoA_reserve(ParticleSoA* soa, size_t capacity)
+{
+    if (capacity <= soa->capacity)
+    {
+        return 1;
+    }
+    size_t size = 64;  // Room to align the first array
+    size += (sizeof(*soa->position) * capacity + 63) & ~(size_t)63;
+    size += (sizeof(*soa->velocity) * capacity + 63) & ~(size_t)63;
+    size += (sizeof(*soa->mass) * capacity + 63) & ~(size_t)63;
+    size += (sizeof(*soa->flags) * capacity + 63) & ~(size_t)63;
+    char* block = (char*)malloc(size);
+    if (!block)
+    {
+        return 0;
+    }
+    char* p = (char*)(((uintptr_t)block + 63) & ~(uintptr_t)63);
+    char* position = p;
+    p += (sizeof(*soa->position) * capacity + 63) & ~(size_t)63;
+    if (soa->count)
+    {
+        memcpy(position, soa->position, sizeof(*soa->position) * soa->count);
+    }
+    char* velocity = p;
+    p += (sizeof(*soa->velocity) * capacity + 63) & ~(size_t)63;
+    if (soa->count)
+    {
+        memcpy(velocity, soa->velocity, sizeof(*soa->velocity) * soa->count);
+    }
+    char* mass = p;
+    p += (sizeof(*soa->mass) * capacity + 63) & ~(size_t)63;
+    if (soa->count)
+    {
+        memcpy(mass, soa->mass, sizeof(*soa->mass) * soa->count);
+    }
+    char* flags = p;
+    p += (sizeof(*soa->flags) * capacity + 63) & ~(size_t)63;
+    if (soa->count)
+    {
+        memcpy(flags, soa->flags, sizeof(*soa->flags) * soa->count);
+    }
+    free(soa->block);
+    soa->block = block;
+    soa->position = (float (*)[3])position;
+    soa->velocity = (float (*)[3])velocity;
+    soa->mass = (float*)mass;
+    soa->flags = (int32_t*)flags;
+    soa->capacity = capacity;
+    return 1;
+}
+
+static inline void ParticleSoA_set(ParticleSoA* soa, size_t i, const Particle* value)
+{
+    memcpy(soa->position[i], value->position, sizeof(value->position));
+    memcpy(soa->velocity[i], value->velocity, sizeof(value->velocity));
+    soa->mass[i] = value->mass;
+    soa->flags[i] = value->flags;
+}
+
+static inline Particle ParticleSoA_get(const ParticleSoA* soa, size_t i)
+{
+    Particle value;
+    memcpy(value.position, soa->position[i], sizeof(value.position));
+    memcpy(value.velocity, soa->velocity[i], sizeof(value.velocity));
+    value.mass = soa->mass[i];
+    value.flags = soa->flags[i];
+    return value;
+}
+
+// Returns the index of the new element, or (size_t)-1 when out of memory.
+static inline size_t ParticleSoA_push(ParticleSoA* soa, const Particle* value)
+{
+    if (soa->count == soa->capacity &&
+        !ParticleSoA_reserve(soa, soa->capacity ? 2 * soa->capacity : 64))
+    {
+        return (size_t)-1;
+    }
+    size_t i = soa->count++;
+    ParticleSoA_set(soa, i, value);
+    return i;
+}
+
+// Moves the last element into slot i. Doesn't keep the order.
+static inline void ParticleSoA_swap_remove(ParticleSoA* soa, size_t i)
+{
+    size_t last = --soa->count;
+    if (i != last)
+    {
+        memcpy(soa->position[i], soa->position[last], sizeof(*soa->position));
+        memcpy(soa->velocity[i], soa->velocity[last], sizeof(*soa->velocity));
+        soa->mass[i] = soa->mass[last];
+        soa->flags[i] = soa->flags[last];
+    }
+}
+
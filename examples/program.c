@@ -1,8 +1,17 @@
 #include <inttypes.h>
 #include "vector.h"
+#include "particle.h"
+#include "particle_soa.h"
+#include "particle_layout.h"
 
 int main()
 {
 	v2f vf = { 1.0f, 2.0f };
 	v2i vi = { 1, 2 };
+
+	ParticleSoA particles;
+	ParticleSoA_init(&particles);
+	Particle p = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 1.0f, 0 };
+	ParticleSoA_push(&particles, &p);
+	ParticleSoA_free(&particles);
 }
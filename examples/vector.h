@@ -1,4 +1,4 @@
-//File generated from template by ad-C.
+//File generated from template by libserg/meta.h.
 
 //vector.adc
 
@@ -58,3 +58,303 @@ typedef struct v3i_s
     };
 } v3i;
 
+//vector_ops.adc
+
+// Bindings:
+//  name_2, name_3  -- vector types from vector.adc
+//  type            -- component type
+//  is_float        -- 1 if type is float. Enables normalize and lerp.
+//
+// All of it is plain scalar code. A 3-wide vector fills an SSE register badly,
+// and packing and unpacking it around each operation cost more than the
+// operation saved; compilers vectorize loops over the scalar versions instead.
+
+#include <math.h>
+
+static inline v2f v2f_add(v2f a, v2f b)
+{
+    v2f r = { { { a.x + b.x, a.y + b.y } } };
+    return r;
+}
+
+static inline v2f v2f_sub(v2f a, v2f b)
+{
+    v2f r = { { { a.x - b.x, a.y - b.y } } };
+    return r;
+}
+
+static inline v2f v2f_mul(v2f a, v2f b)
+{
+    v2f r = { { { a.x * b.x, a.y * b.y } } };
+    return r;
+}
+
+static inline float v2f_dot(v2f a, v2f b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+// z component of the 3D cross product.
+static inline float v2f_cross(v2f a, v2f b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+static inline float v2f_length(v2f a)
+{
+    return sqrtf((float)v2f_dot(a, a));
+}
+
+static inline v2f v2f_min(v2f a, v2f b)
+{
+    v2f r = { { { a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y } } };
+    return r;
+}
+
+static inline v2f v2f_max(v2f a, v2f b)
+{
+    v2f r = { { { a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y } } };
+    return r;
+}
+
+#if 1
+// Returns a unchanged if it has zero length.
+static inline v2f v2f_normalize(v2f a)
+{
+    float len = v2f_length(a);
+    if (len > 0.0f)
+    {
+        a.x /= len;
+        a.y /= len;
+    }
+    return a;
+}
+
+static inline v2f v2f_lerp(v2f a, v2f b, float t)
+{
+    v2f r = { { { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t } } };
+    return r;
+}
+#endif
+
+static inline v3f v3f_add(v3f a, v3f b)
+{
+    v3f r = { { { a.x + b.x, a.y + b.y, a.z + b.z } } };
+    return r;
+}
+
+static inline v3f v3f_sub(v3f a, v3f b)
+{
+    v3f r = { { { a.x - b.x, a.y - b.y, a.z - b.z } } };
+    return r;
+}
+
+static inline v3f v3f_mul(v3f a, v3f b)
+{
+    v3f r = { { { a.x * b.x, a.y * b.y, a.z * b.z } } };
+    return r;
+}
+
+static inline float v3f_dot(v3f a, v3f b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline v3f v3f_cross(v3f a, v3f b)
+{
+    v3f r = { { { a.y * b.z - a.z * b.y,
+                      a.z * b.x - a.x * b.z,
+                      a.x * b.y - a.y * b.x } } };
+    return r;
+}
+
+static inline v3f v3f_min(v3f a, v3f b)
+{
+    v3f r = { { { a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z } } };
+    return r;
+}
+
+static inline v3f v3f_max(v3f a, v3f b)
+{
+    v3f r = { { { a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z } } };
+    return r;
+}
+
+#if 1
+static inline v3f v3f_lerp(v3f a, v3f b, float t)
+{
+    v3f r = { { { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t } } };
+    return r;
+}
+#endif
+
+static inline float v3f_length(v3f a)
+{
+    return sqrtf((float)v3f_dot(a, a));
+}
+
+#if 1
+// Returns a unchanged if it has zero length.
+static inline v3f v3f_normalize(v3f a)
+{
+    float len = v3f_length(a);
+    if (len > 0.0f)
+    {
+        a.x /= len;
+        a.y /= len;
+        a.z /= len;
+    }
+    return a;
+}
+#endif
+
+//vector_ops.adc
+
+// Bindings:
+//  name_2, name_3  -- vector types from vector.adc
+//  type            -- component type
+//  is_float        -- 1 if type is float. Enables normalize and lerp.
+//
+// All of it is plain scalar code. A 3-wide vector fills an SSE register badly,
+// and packing and unpacking it around each operation cost more than the
+// operation saved; compilers vectorize loops over the scalar versions instead.
+
+#include <math.h>
+
+static inline v2i v2i_add(v2i a, v2i b)
+{
+    v2i r = { { { a.x + b.x, a.y + b.y } } };
+    return r;
+}
+
+static inline v2i v2i_sub(v2i a, v2i b)
+{
+    v2i r = { { { a.x - b.x, a.y - b.y } } };
+    return r;
+}
+
+static inline v2i v2i_mul(v2i a, v2i b)
+{
+    v2i r = { { { a.x * b.x, a.y * b.y } } };
+    return r;
+}
+
+static inline int32_t v2i_dot(v2i a, v2i b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+// z component of the 3D cross product.
+static inline int32_t v2i_cross(v2i a, v2i b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+static inline float v2i_length(v2i a)
+{
+    return sqrtf((float)v2i_dot(a, a));
+}
+
+static inline v2i v2i_min(v2i a, v2i b)
+{
+    v2i r = { { { a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y } } };
+    return r;
+}
+
+static inline v2i v2i_max(v2i a, v2i b)
+{
+    v2i r = { { { a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y } } };
+    return r;
+}
+
+#if 0
+// Returns a unchanged if it has zero length.
+static inline v2i v2i_normalize(v2i a)
+{
+    float len = v2i_length(a);
+    if (len > 0.0f)
+    {
+        a.x /= len;
+        a.y /= len;
+    }
+    return a;
+}
+
+static inline v2i v2i_lerp(v2i a, v2i b, float t)
+{
+    v2i r = { { { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t } } };
+    return r;
+}
+#endif
+
+static inline v3i v3i_add(v3i a, v3i b)
+{
+    v3i r = { { { a.x + b.x, a.y + b.y, a.z + b.z } } };
+    return r;
+}
+
+static inline v3i v3i_sub(v3i a, v3i b)
+{
+    v3i r = { { { a.x - b.x, a.y - b.y, a.z - b.z } } };
+    return r;
+}
+
+static inline v3i v3i_mul(v3i a, v3i b)
+{
+    v3i r = { { { a.x * b.x, a.y * b.y, a.z * b.z } } };
+    return r;
+}
+
+static inline int32_t v3i_dot(v3i a, v3i b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline v3i v3i_cross(v3i a, v3i b)
+{
+    v3i r = { { { a.y * b.z - a.z * b.y,
+                      a.z * b.x - a.x * b.z,
+                      a.x * b.y - a.y * b.x } } };
+    return r;
+}
+
+static inline v3i v3i_min(v3i a, v3i b)
+{
+    v3i r = { { { a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z } } };
+    return r;
+}
+
+static inline v3i v3i_max(v3i a, v3i b)
+{
+    v3i r = { { { a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z } } };
+    return r;
+}
+
+#if 0
+static inline v3i v3i_lerp(v3i a, v3i b, float t)
+{
+    v3i r = { { { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t } } };
+    return r;
+}
+#endif
+
+static inline float v3i_length(v3i a)
+{
+    return sqrtf((float)v3i_dot(a, a));
+}
+
+#if 0
+// Returns a unchanged if it has zero length.
+static inline v3i v3i_normalize(v3i a)
+{
+    float len = v3i_length(a);
+    if (len > 0.0f)
+    {
+        a.x /= len;
+        a.y /= len;
+        a.z /= len;
+    }
+    return a;
+}
+#endif
+
@@ -0,0 +1,119 @@
+// Checks the generated vector operations (vector_ops.adc) against a plain
+// scalar reference.
+
+#include <assert.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vector.h"
+
+static int close_enough(float a, float b)
+{
+    float diff = fabsf(a - b);
+    float scale = fabsf(a) > fabsf(b) ? fabsf(a) : fabsf(b);
+    return diff <= 1e-5f * (scale > 1.0f ? scale : 1.0f);
+}
+
+static int v3f_close(v3f a, float x, float y, float z)
+{
+    return close_enough(a.x, x) && close_enough(a.y, y) && close_enough(a.z, z);
+}
+
+static float random_float()
+{
+    return (float)rand() / (float)RAND_MAX * 200.0f - 100.0f;
+}
+
+static void test_v2f(v2f a, v2f b, float t)
+{
+    v2f r;
+    r = v2f_add(a, b);
+    assert(close_enough(r.x, a.x + b.x) && close_enough(r.y, a.y + b.y));
+    r = v2f_sub(a, b);
+    assert(close_enough(r.x, a.x - b.x) && close_enough(r.y, a.y - b.y));
+    r = v2f_mul(a, b);
+    assert(close_enough(r.x, a.x * b.x) && close_enough(r.y, a.y * b.y));
+    assert(close_enough(v2f_dot(a, b), a.x * b.x + a.y * b.y));
+    assert(close_enough(v2f_cross(a, b), a.x * b.y - a.y * b.x));
+    assert(close_enough(v2f_length(a), sqrtf(a.x * a.x + a.y * a.y)));
+    r = v2f_min(a, b);
+    assert(r.x == fminf(a.x, b.x) && r.y == fminf(a.y, b.y));
+    r = v2f_max(a, b);
+    assert(r.x == fmaxf(a.x, b.x) && r.y == fmaxf(a.y, b.y));
+    r = v2f_lerp(a, b, t);
+    assert(close_enough(r.x, a.x + (b.x - a.x) * t) && close_enough(r.y, a.y + (b.y - a.y) * t));
+    r = v2f_normalize(a);
+    float len = sqrtf(a.x * a.x + a.y * a.y);
+    assert(close_enough(r.x, a.x / len) && close_enough(r.y, a.y / len));
+}
+
+static void test_v3f(v3f a, v3f b, float t)
+{
+    assert(v3f_close(v3f_add(a, b), a.x + b.x, a.y + b.y, a.z + b.z));
+    assert(v3f_close(v3f_sub(a, b), a.x - b.x, a.y - b.y, a.z - b.z));
+    assert(v3f_close(v3f_mul(a, b), a.x * b.x, a.y * b.y, a.z * b.z));
+    assert(close_enough(v3f_dot(a, b), a.x * b.x + a.y * b.y + a.z * b.z));
+    assert(v3f_close(v3f_cross(a, b),
+                     a.y * b.z - a.z * b.y,
+                     a.z * b.x - a.x * b.z,
+                     a.x * b.y - a.y * b.x));
+    assert(close_enough(v3f_length(a), sqrtf(a.x * a.x + a.y * a.y + a.z * a.z)));
+    assert(v3f_close(v3f_min(a, b), fminf(a.x, b.x), fminf(a.y, b.y), fminf(a.z, b.z)));
+    assert(v3f_close(v3f_max(a, b), fmaxf(a.x, b.x), fmaxf(a.y, b.y), fmaxf(a.z, b.z)));
+    assert(v3f_close(v3f_lerp(a, b, t),
+                     a.x + (b.x - a.x) * t,
+                     a.y + (b.y - a.y) * t,
+                     a.z + (b.z - a.z) * t));
+    float len = sqrtf(a.x * a.x + a.y * a.y + a.z * a.z);
+    assert(v3f_close(v3f_normalize(a), a.x / len, a.y / len, a.z / len));
+}
+
+static void test_v3i(v3i a, v3i b)
+{
+    v3i r;
+    r = v3i_add(a, b);
+    assert(r.x == a.x + b.x && r.y == a.y + b.y && r.z == a.z + b.z);
+    r = v3i_sub(a, b);
+    assert(r.x == a.x - b.x && r.y == a.y - b.y && r.z == a.z - b.z);
+    r = v3i_mul(a, b);
+    assert(r.x == a.x * b.x && r.y == a.y * b.y && r.z == a.z * b.z);
+    assert(v3i_dot(a, b) == a.x * b.x + a.y * b.y + a.z * b.z);
+    r = v3i_cross(a, b);
+    assert(r.x == a.y * b.z - a.z * b.y && r.y == a.z * b.x - a.x * b.z && r.z == a.x * b.y - a.y * b.x);
+    r = v3i_min(a, b);
+    assert(r.x == (a.x < b.x ? a.x : b.x) && r.z == (a.z < b.z ? a.z : b.z));
+    r = v3i_max(a, b);
+    assert(r.x == (a.x > b.x ? a.x : b.x) && r.z == (a.z > b.z ? a.z : b.z));
+
+    v2i a2 = { { { a.x, a.y } } };
+    v2i b2 = { { { b.x, b.y } } };
+    assert(v2i_dot(a2, b2) == a.x * b.x + a.y * b.y);
+    assert(v2i_cross(a2, b2) == a.x * b.y - a.y * b.x);
+}
+
+int main()
+{
+    srand(1729);
+    for (int i = 0; i < 100000; ++i)
+    {
+        v2f a2 = { { { random_float(), random_float() } } };
+        v2f b2 = { { { random_float(), random_float() } } };
+        v3f a3 = { { { random_float(), random_float(), random_float() } } };
+        v3f b3 = { { { random_float(), random_float(), random_float() } } };
+        float t = (float)rand() / (float)RAND_MAX;
+        test_v2f(a2, b2, t);
+        test_v3f(a3, b3, t);
+
+        v3i ai = { { { rand() % 2000 - 1000, rand() % 2000 - 1000, rand() % 2000 - 1000 } } };
+        v3i bi = { { { rand() % 2000 - 1000, rand() % 2000 - 1000, rand() % 2000 - 1000 } } };
+        test_v3i(ai, bi);
+    }
+
+    v3f zero = { { { 0.0f, 0.0f, 0.0f } } };
+    v3f n = v3f_normalize(zero);
+    assert(n.x == 0.0f && n.y == 0.0f && n.z == 0.0f);
+
+    printf("Vector ops match the scalar reference.\n");
+}
@@ -30,7 +30,10 @@ extern "C"
 #endif
 
 #if defined(__linux__)
-#define _BSD_SOURCE  // to get usleep with -std=c99
+#define _BSD_SOURCE  // to get d_type with -std=c99
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE  // The same for glibc 2.20+, plus dirfd and d_type
+#endif
 #endif
 
 #ifndef assert
@@ -162,11 +165,15 @@ int32_t         sgl_cpu_count(void);
 SglSemaphore*   sgl_create_semaphore(int32_t value);
 int32_t         sgl_semaphore_wait(SglSemaphore* sem);  // Will return non-zero on error
 int32_t         sgl_semaphore_signal(SglSemaphore* sem);
+void            sgl_destroy_semaphore(SglSemaphore* sem);
 SglMutex*       sgl_create_mutex(void);
 int32_t         sgl_mutex_lock(SglMutex* mutex);
 int32_t         sgl_mutex_unlock(SglMutex* mutex);
 void            sgl_destroy_mutex(SglMutex* mutex);
 void            sgl_create_thread(void (*thread_func)(void*), void* params);
+// Runs worker(params) on num_threads threads and returns when all of them
+// have returned. With num_threads <= 1, it runs on the calling thread.
+void            sgl_run_workers(int32_t num_threads, void (*worker)(void*), void* params);
 void            sgl_usleep(int32_t us);
 #define         sgl_memory_barrier() SGL_MEMORY_BARRIER_PLAT_  // No reads or writes before or after this call.
 
@@ -185,6 +192,43 @@ char*   sgl_strip_whitespace(char* in);
 int32_t sgl_count_lines(char* contents);
 
 
+// ====
+// Directory walking
+// ====
+
+// Called for every directory, before the files in it, and for every file.
+// `path` is the root followed by the names below it, joined with '/'. It is
+// only valid during the call. `name` points to its last component.
+typedef void (*SglWalkFunc)(void* user_data, const char* path, const char* name, int32_t is_dir);
+
+typedef struct
+{
+    // Only files with one of these extensions (no dot) are reported. NULL
+    // reports every file.
+    const char**    extensions;
+    int32_t         num_extensions;
+    // Files and directories with a name matching one of these globs are
+    // skipped, directories with everything under them. e.g. ".git", "build*"
+    const char**    ignore;
+    int32_t         num_ignore;
+    // With more than one thread, directories are read in parallel and `func`
+    // is called from all of them, in no particular order. Otherwise a
+    // directory's files come right after it, and subdirectories are walked
+    // last-found first.
+    int32_t         num_threads;
+} SglWalkOptions;
+
+// Walks the tree under `root` with an explicit stack, so depth is only
+// limited by memory. Entry types come from d_type (FindFirstFile on Windows);
+// entries are only stat'ed when the file system doesn't fill it in. Links to
+// directories are not followed. `options` may be NULL.
+// Returns the number of files reported, or -1 if root can't be opened.
+int32_t sgl_walk_dir(const char* root, const SglWalkOptions* options, SglWalkFunc func, void* user_data);
+
+// '*' matches any run of characters, '?' any one character.
+int32_t sgl_glob_match(const char* pattern, const char* name);
+
+
 // ====
 // Windows helpers
 // ====
@@ -392,6 +436,14 @@ int32_t sgl_semaphore_signal(SglSemaphore* sem)
     return 0;
 }
 
+void sgl_destroy_semaphore(SglSemaphore* sem)
+{
+    if (sem) {
+        CloseHandle(sem->handle);
+        sgl_free(sem);
+    }
+}
+
 SglMutex* sgl_create_mutex()
 {
     SglMutex* mutex = (SglMutex*) sgl_malloc(sizeof(SglMutex));
@@ -441,6 +493,7 @@ void sgl_create_thread(void (*thread_func)(void*), void* params)
 #include <unistd.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <sys/select.h>
 
 #if defined(__MACH__)
 #include <fcntl.h>
@@ -451,12 +504,10 @@ void sgl_create_thread(void (*thread_func)(void*), void* params)
 
 void sgl_usleep(int32_t us)
 {
-#if defined(__linux__)
-    __useconds_t u = (__useconds_t)us;
-#elif defined(__MACH__)
-    useconds_t u = (useconds_t)us;
-    usleep(u);
-#endif
+    // Not usleep(): with -std=c99 it isn't declared if a system header was
+    // included before this file.
+    struct timeval tv = { us / 1000000, us % 1000000 };
+    select(0, NULL, NULL, NULL, &tv);
 }
 
 int32_t sgl_cpu_count()
@@ -481,8 +532,16 @@ SglSemaphore* sgl_create_semaphore(int32_t value)
     sem->sem = (sem_t*)sgl_malloc(sizeof(sem_t));
     int err = sem_init(sem->sem, 0, value);
 #elif defined(__MACH__)
-    sem->sem = sem_open("sgl semaphore", O_CREAT, S_IRWXU, value);
+    // No unnamed semaphores on macOS. Every one gets its own name, unlinked
+    // right away, so that semaphores alive at the same time stay separate.
+    static int32_t counter;
+    char name[32];
+    snprintf(name, sizeof(name), "/sgl%d.%d", (int)getpid(), (int)__sync_fetch_and_add(&counter, 1));
+    sem->sem = sem_open(name, O_CREAT | O_EXCL, S_IRWXU, value);
     int err = (sem->sem == SEM_FAILED) ? -1 : 0;
+    if (!err) {
+        sem_unlink(name);
+    }
 #endif
     if (err < 0) {
         sgl_free(sem);
@@ -500,6 +559,20 @@ int32_t sgl_semaphore_signal(SglSemaphore* sem)
 {
     return sem_post(sem->sem);
 }
+
+void sgl_destroy_semaphore(SglSemaphore* sem)
+{
+    if (sem) {
+#if defined(__linux__)
+        sem_destroy(sem->sem);
+        sgl_free(sem->sem);
+#elif defined(__MACH__)
+        sem_close(sem->sem);
+#endif
+        sgl_free(sem);
+    }
+}
+
 struct SglMutex_s
 {
     pthread_mutex_t handle;
@@ -553,13 +626,15 @@ void sgl_create_thread(void (*thread_func)(void*), void* params)
     {
         assert(!"Not handling thread attribute failure.");
     }
-    //pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    // Nobody joins these. Detached, they free their resources when they end.
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
 
     pthread_t leaked_thread;
     if (pthread_create(&leaked_thread, &attr, (void*(*)(void*))(thread_func), params) != 0)
     {
         assert (!"God dammit");
     }
+    pthread_attr_destroy(&attr);
 }
 
 // =================================
@@ -567,6 +642,37 @@ void sgl_create_thread(void (*thread_func)(void*), void* params)
 // =================================
 #endif  // Platforms
 
+typedef struct
+{
+    void            (*worker)(void*);
+    void*           params;
+    SglSemaphore*   done;
+} SglWorkers;
+
+static void sgli__worker_main(void* data)
+{
+    SglWorkers* workers = (SglWorkers*)data;
+    workers->worker(workers->params);
+    sgl_semaphore_signal(workers->done);
+}
+
+void sgl_run_workers(int32_t num_threads, void (*worker)(void*), void* params)
+{
+    if (num_threads <= 1) {
+        worker(params);
+        return;
+    }
+    SglWorkers workers = { worker, params, sgl_create_semaphore(0) };
+    assert(workers.done);
+    for (int32_t i = 0; i < num_threads; ++i) {
+        sgl_create_thread(sgli__worker_main, &workers);
+    }
+    for (int32_t i = 0; i < num_threads; ++i) {
+        sgl_semaphore_wait(workers.done);
+    }
+    sgl_destroy_semaphore(workers.done);
+}
+
 // =================================================================================================
 // IO
 // =================================================================================================
@@ -706,6 +812,308 @@ int sgl_is_number(char* s)
     return ok;
 }
 
+// =================================================================================================
+// Directory walking
+// =================================================================================================
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+typedef struct
+{
+    const SglWalkOptions*   options;
+    SglWalkFunc             func;
+    void*                   user_data;
+
+    char**                  stack;          // sb_ of directories left to read
+    int32_t                 num_pending;    // Pushed and not done reading
+    int32_t                 num_files;
+
+    // Parallel walks only
+    int32_t                 num_threads;
+    SglMutex*               mutex;
+    SglSemaphore*           work;           // One count per directory pushed
+} SglWalk;
+
+int32_t sgl_glob_match(const char* pattern, const char* name)
+{
+    // Backtrack to the last '*' on a mismatch.
+    const char* star = NULL;
+    const char* star_name = NULL;
+    while (*name) {
+        if (*pattern == '*') {
+            star = pattern++;
+            star_name = name;
+        } else if (*pattern == '?' || *pattern == *name) {
+            ++pattern;
+            ++name;
+        } else if (star) {
+            pattern = star + 1;
+            name = ++star_name;
+        } else {
+            return 0;
+        }
+    }
+    while (*pattern == '*') {
+        ++pattern;
+    }
+    return *pattern == '\0';
+}
+
+static int32_t sgli__walk_ignored(const SglWalkOptions* options, const char* name)
+{
+    for (int32_t i = 0; i < options->num_ignore; ++i) {
+        if (sgl_glob_match(options->ignore[i], name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int32_t sgli__walk_wanted(const SglWalkOptions* options, const char* name)
+{
+    if (!options->extensions) {
+        return 1;
+    }
+    const char* ext = strrchr(name, '.');
+    if (!ext) {
+        return 0;
+    }
+    for (int32_t i = 0; i < options->num_extensions; ++i) {
+        if (!strcmp(ext + 1, options->extensions[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void sgli__walk_lock(SglWalk* walk)
+{
+    if (walk->mutex) {
+        sgl_mutex_lock(walk->mutex);
+    }
+}
+
+static void sgli__walk_unlock(SglWalk* walk)
+{
+    if (walk->mutex) {
+        sgl_mutex_unlock(walk->mutex);
+    }
+}
+
+// Writes dir/name into *buffer, growing it. Returns the offset of name.
+static size_t sgli__walk_join(char** buffer, size_t* capacity, const char* dir, size_t dir_len, const char* name)
+{
+    size_t name_len = strlen(name);
+    int32_t slash = dir_len && dir[dir_len - 1] != '/' && dir[dir_len - 1] != '\\';
+    size_t size = dir_len + slash + name_len + 1;
+    if (size > *capacity) {
+        *capacity = size * 2;
+        *buffer = (char*)sgl_realloc(*buffer, *capacity);
+        assert(*buffer);
+    }
+    memcpy(*buffer, dir, dir_len);
+    if (slash) {
+        (*buffer)[dir_len] = '/';
+    }
+    memcpy(*buffer + dir_len + slash, name, name_len + 1);
+    return dir_len + slash;
+}
+
+static const char* sgli__walk_base_name(const char* path)
+{
+    const char* name = path;
+    for (const char* c = path; *c; ++c) {
+        if ((*c == '/' || *c == '\\') && c[1]) {
+            name = c + 1;
+        }
+    }
+    return name;
+}
+
+static void sgli__walk_push(SglWalk* walk, const char* path)
+{
+    size_t len = strlen(path);
+    char* copy = (char*)sgl_malloc(len + 1);
+    assert(copy);
+    memcpy(copy, path, len + 1);
+    sgli__walk_lock(walk);
+    sb_push(walk->stack, copy);
+    ++walk->num_pending;
+    sgli__walk_unlock(walk);
+    if (walk->work) {
+        sgl_semaphore_signal(walk->work);
+    }
+}
+
+// Reports the directory and its files, and pushes its subdirectories.
+static int32_t sgli__walk_read(SglWalk* walk, const char* dir_path)
+{
+    const SglWalkOptions* options = walk->options;
+    size_t dir_len = strlen(dir_path);
+    char* path = NULL;
+    size_t capacity = 0;
+    int32_t num_files = 0;
+#if defined(_WIN32)
+    sgli__walk_join(&path, &capacity, dir_path, dir_len, "*");
+    WIN32_FIND_DATAA find_data;
+    HANDLE find = FindFirstFileA(path, &find_data);
+    if (find == INVALID_HANDLE_VALUE) {
+        sgl_free(path);
+        return 0;
+    }
+    walk->func(walk->user_data, dir_path, sgli__walk_base_name(dir_path), 1);
+    do {
+        const char* name = find_data.cFileName;
+        DWORD attributes = find_data.dwFileAttributes;
+        if (!strcmp(name, ".") || !strcmp(name, "..") || sgli__walk_ignored(options, name)) {
+            continue;
+        }
+        int32_t is_dir = (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if (is_dir && (attributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+            continue;  // Links and junctions
+        }
+#else
+    DIR* dir = opendir(dir_path);
+    if (!dir) {
+        return 0;
+    }
+    walk->func(walk->user_data, dir_path, sgli__walk_base_name(dir_path), 1);
+    for (struct dirent* ent = readdir(dir); ent; ent = readdir(dir)) {
+        const char* name = ent->d_name;
+        if (!strcmp(name, ".") || !strcmp(name, "..") || sgli__walk_ignored(options, name)) {
+            continue;
+        }
+#if defined(DT_DIR)
+        int32_t is_dir = ent->d_type == DT_DIR;
+        if (ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK) {
+            // Links to files count as files.
+            struct stat st;
+            int fd = dirfd(dir);
+            if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+            if (S_ISLNK(st.st_mode) && (fstatat(fd, name, &st, 0) != 0 || S_ISDIR(st.st_mode))) {
+                continue;
+            }
+            is_dir = S_ISDIR(st.st_mode);
+            if (!is_dir && !S_ISREG(st.st_mode)) {
+                continue;
+            }
+        }
+        else if (ent->d_type != DT_REG && !is_dir) {
+            continue;  // Sockets, pipes, devices
+        }
+#else
+        // Strict C99 with a system header included before this file: no d_type
+        // or lstat. stat() follows links, links to directories included.
+        struct stat st;
+        sgli__walk_join(&path, &capacity, dir_path, dir_len, name);
+        if (stat(path, &st) != 0 || !(S_ISDIR(st.st_mode) || S_ISREG(st.st_mode))) {
+            continue;
+        }
+        int32_t is_dir = S_ISDIR(st.st_mode);
+#endif
+#endif
+        if (!is_dir && !sgli__walk_wanted(options, name)) {
+            continue;
+        }
+        size_t name_offset = sgli__walk_join(&path, &capacity, dir_path, dir_len, name);
+        if (is_dir) {
+            sgli__walk_push(walk, path);
+        } else {
+            walk->func(walk->user_data, path, path + name_offset, 0);
+            ++num_files;
+        }
+#if defined(_WIN32)
+    } while (FindNextFileA(find, &find_data));
+    FindClose(find);
+#else
+    }
+    closedir(dir);
+#endif
+    sgl_free(path);
+
+    sgli__walk_lock(walk);
+    walk->num_files += num_files;
+    sgli__walk_unlock(walk);
+    return 1;
+}
+
+// Workers sleep on `work` until a directory is pushed. When the last pending
+// directory is read, the stack is empty for good, and every worker is woken
+// to find that out.
+static void sgli__walk_worker(void* data)
+{
+    SglWalk* walk = (SglWalk*)data;
+    for (;;) {
+        sgl_semaphore_wait(walk->work);
+        char* dir_path = NULL;
+        sgl_mutex_lock(walk->mutex);
+        if (sb_count(walk->stack)) {
+            dir_path = walk->stack[--sgl__sbcount(walk->stack)];
+        }
+        sgl_mutex_unlock(walk->mutex);
+        if (!dir_path) {
+            break;
+        }
+
+        if (!sgli__walk_read(walk, dir_path)) {
+            fprintf(stderr, "ERROR: couldn't open directory %s\n", dir_path);
+        }
+        sgl_free(dir_path);
+
+        sgl_mutex_lock(walk->mutex);
+        int32_t finished = --walk->num_pending == 0;
+        sgl_mutex_unlock(walk->mutex);
+        if (finished) {
+            for (int32_t i = 0; i < walk->num_threads; ++i) {
+                sgl_semaphore_signal(walk->work);
+            }
+        }
+    }
+}
+
+int32_t sgl_walk_dir(const char* root, const SglWalkOptions* options, SglWalkFunc func, void* user_data)
+{
+    SglWalkOptions no_options = { 0 };
+    SglWalk walk = { 0 };
+    walk.options = options ? options : &no_options;
+    walk.func = func;
+    walk.user_data = user_data;
+
+    // The root is read here, so that a missing root is an error.
+    if (!sgli__walk_read(&walk, root)) {
+        return -1;
+    }
+
+    walk.num_threads = walk.options->num_threads;
+    if (walk.num_threads > 1 && sb_count(walk.stack)) {
+        walk.mutex = sgl_create_mutex();
+        walk.work = sgl_create_semaphore(sb_count(walk.stack));
+        assert(walk.mutex && walk.work);
+        sgl_run_workers(walk.num_threads, sgli__walk_worker, &walk);
+        sgl_destroy_semaphore(walk.work);
+        sgl_destroy_mutex(walk.mutex);
+    } else {
+        while (sb_count(walk.stack)) {
+            char* dir_path = walk.stack[--sgl__sbcount(walk.stack)];
+            if (!sgli__walk_read(&walk, dir_path)) {
+                fprintf(stderr, "ERROR: couldn't open directory %s\n", dir_path);
+            }
+            sgl_free(dir_path);
+        }
+    }
+    if (walk.stack) {
+        int* stack = sgl__sbraw(walk.stack);
+        sgl_free(stack);
+    }
+    return walk.num_files;
+}
+
 #ifdef _WIN32
 void sgl_win32_log(char *format, ...)
 {
@@ -738,3 +1146,5 @@ void sgl_win32_log(char *format, ...)
 
 // HISTORY
 // 2015-09-25 -- Added LIBSERG_IMPLEMENTATION macro, sgl_split_lines()
+// 2026-10-16 -- Added sgl_walk_dir(), sgl_glob_match(), sgl_run_workers(), sgl_destroy_semaphore().
+//               sgl_usleep() sleeps on Linux. Threads are detached.
@@ -1,8 +1,19 @@
+#define LIBSERG_IMPLEMENTATION
 #include "libserg.h"
 
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#if defined(_WIN32)
+#include <direct.h>
+#define test_mkdir(path) _mkdir(path)
+#define test_rmdir(path) _rmdir(path)
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define test_mkdir(path) mkdir(path, 0755)
+#define test_rmdir(path) rmdir(path)
+#endif
 
 static SglMutex* g_mutex;
 static int32_t total_sum;
@@ -18,6 +29,51 @@ static void sum_thread(void* params)
     sgl_semaphore_signal(g_sem);
 }
 
+static void count_worker(void* params)
+{
+    int32_t* count = (int32_t*)params;
+    sgl_mutex_lock(g_mutex);
+    ++*count;
+    sgl_mutex_unlock(g_mutex);
+}
+
+typedef struct
+{
+    int32_t num_files;
+    int32_t num_dirs;
+    int32_t num_c;
+} WalkCount;
+
+static void count_walk(void* user_data, const char* path, const char* name, int32_t is_dir)
+{
+    WalkCount* count = (WalkCount*)user_data;
+    sgl_mutex_lock(g_mutex);
+    if (is_dir)
+    {
+        count->num_dirs++;
+    }
+    else
+    {
+        count->num_files++;
+        size_t len = strlen(name);
+        count->num_c += len > 2 && !strcmp(name + len - 2, ".c");
+    }
+    assert (strstr(path, "walk_test") == path);
+    assert (!strstr(path, ".git"));
+    sgl_mutex_unlock(g_mutex);
+}
+
+static const char* walk_test_files[] =
+{
+    "walk_test/a.c", "walk_test/b.h", "walk_test/notes.txt",
+    "walk_test/sub/c.c", "walk_test/sub/deep/d.c", "walk_test/.git/e.c",
+};
+
+static const char* walk_test_dirs[] =
+{
+    "walk_test/sub/deep", "walk_test/sub", "walk_test/.git", "walk_test",
+};
+
 #define TEST_STACK_SIZE 10
 int main()
 {
@@ -36,17 +92,17 @@ int main()
         {
             sub_arenas[i] = arena_push(&arena, saz);
             Arena* sa = &sub_arenas[i];
-            int32_t* seq = arena_make_stack(sa, TEST_STACK_SIZE, int32_t);
+            int32_t* seq = arena_alloc_array(sa, TEST_STACK_SIZE, int32_t);
             for (int32_t j = 0; j < TEST_STACK_SIZE; ++j)
             {
-                arena_stack_push(seq, j);
+                seq[j] = j;
             }
             arrays[i] = seq;
         }
 
         for (int32_t i = 0; i < sgl_array_count(sub_arenas); ++i)
         {
-            for (int32_t j = 0; j < arena_stack_count(arrays[i]); ++j)
+            for (int32_t j = 0; j < TEST_STACK_SIZE; ++j)
             {
                 assert ( arrays[i][j] == j);
             }
@@ -82,15 +138,73 @@ int main()
     assert (total_sum == 20100);
 
     {
-        size_t size = 0;
+        int32_t num_ran = 0;
+        sgl_run_workers(8, count_worker, &num_ran);
+        assert (num_ran == 8);
+        sgl_run_workers(1, count_worker, &num_ran);
+        assert (num_ran == 9);
+    }
+
+    {
+        int64_t size = 0;
         char* file_contents = sgl_slurp_file("libserg_test.c", &size);
         int num_lines = sgl_count_lines(file_contents);
         printf("The number of lines in this source file is %d\n", num_lines);
+        sgl_free(file_contents);
     }
 
 
+    // Directory walking test:
+    {
+        for (int32_t i = sgl_array_count(walk_test_dirs) - 1; i >= 0; --i)
+        {
+            test_mkdir(walk_test_dirs[i]);
+        }
+        for (int32_t i = 0; i < sgl_array_count(walk_test_files); ++i)
+        {
+            FILE* fd = fopen(walk_test_files[i], "w");
+            assert (fd);
+            fclose(fd);
+        }
+
+        const char* extensions[] = { "c", "h" };
+        const char* ignore[] = { ".g?t" };
+        SglWalkOptions options = { 0 };
+        options.extensions = extensions;
+        options.num_extensions = sgl_array_count(extensions);
+        options.ignore = ignore;
+        options.num_ignore = sgl_array_count(ignore);
+
+        WalkCount serial = { 0 };
+        int32_t num_files = sgl_walk_dir("walk_test", &options, count_walk, &serial);
+        assert (num_files == 4);
+        assert (serial.num_files == 4 && serial.num_dirs == 3 && serial.num_c == 3);
+
+        options.num_threads = 4;
+        WalkCount parallel = { 0 };
+        num_files = sgl_walk_dir("walk_test", &options, count_walk, &parallel);
+        assert (num_files == 4);
+        assert (parallel.num_files == serial.num_files && parallel.num_dirs == serial.num_dirs);
+
+        num_files = sgl_walk_dir("walk_test/missing", NULL, count_walk, NULL);
+        assert (num_files == -1);
+        assert (sgl_glob_match("*.c", "a.c") && !sgl_glob_match("*.c", "a.h"));
+        assert (sgl_glob_match("build*", "build") && sgl_glob_match("?", "x") && !sgl_glob_match("?", ""));
+
+        for (int32_t i = 0; i < sgl_array_count(walk_test_files); ++i)
+        {
+            remove(walk_test_files[i]);
+        }
+        for (int32_t i = 0; i < sgl_array_count(walk_test_dirs); ++i)
+        {
+            test_rmdir(walk_test_dirs[i]);
+        }
+    }
+
     ARENA_VALIDATE(&arena);
     arena_reset(&arena);
+    free(arena.ptr);
+    sgl_destroy_semaphore(g_sem);
     sgl_destroy_mutex(g_mutex);
 }
 
@@ -11,699 +11,6357 @@
 
 #pragma once
 
-#include <assert.h>
-#ifndef _WIN32
-#include <dirent.h>
+// POSIX.1-2008 (st_mtim, and dirfd, fstatat and d_type for sgl_walk_dir) even with -std=c99.
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
 #endif
+
+#include <assert.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #ifdef _WIN32
-#include "win_dirent.h"
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#if defined(__linux__)
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// The template lexer looks for '$' 16 or 32 bytes at a time when SSE2/AVX2 is
+// available, and uses memchr otherwise. Define META_SCALAR_LEXER to get the
+// byte-at-a-time state machine instead.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define META_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define META_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
 #endif
 
 #include "serg_io.h"
 #include "memory.h"
 
+// meta.h goes into a single translation unit, so it carries the libserg
+// implementation it needs (threads, stretchy buffers).
+#ifndef LIBSERG_IMPLEMENTATION
+#define LIBSERG_IMPLEMENTATION
+#endif
+#include "libserg.h"
+
 void meta_clear_file(const char* fname);
 
 // NOTE: this function dumbly replaces text. It doesn't care about grammar.
 // e.g. it will replace tokens inside of strings.
-void meta_expand(
+//
+// The template is memory-mapped and expanded in a single pass through a
+// META_SINK_BUFFER_SIZE write buffer, so memory use doesn't grow with the size
+// of the template or of the output. Returns 0 if the template can't be expanded
+// or result_path can't be opened.
+int  meta_expand(
         const char* result_path,
         const char* tmpl_path,
         const int num_bindings,
         ...);
 
-// Searches for *.c *.h *.cpp and *.cc files in directory_path, parses them,
-// and generates type info at output_path
-void meta_type_info(
-        const char* output_path,
-        const char* directory_path);
+// -- Compiled templates.
+// A template is parsed once into literal spans and $<name> slots. Rendering it
+// is a copy of the spans plus the substitutions, so one template can be
+// stamped over many types without re-reading or re-lexing the .adc file.
+//
+// Usage:
+//      MetaTemplate* tmpl = meta_template_compile("vector.adc");
+//      meta_template_render(tmpl, "vector.h", 1, "type", "float");
+//      meta_template_render(tmpl, "vector.h", 1, "type", "int32_t");
+//      meta_template_free(tmpl);
+//
+// Blocks can be unrolled at generation time with a repeat directive:
+//
+//      $<@repeat i 0 width>    r.d[$<i>] = a.d[$<i>] + b.d[$<i>];
+//      $<@end>
+//
+// The block between $<@repeat> and $<@end> is rendered once for each i in
+// [first, last), with $<i> bound to the index. Bounds are integers or the
+// names of bindings (or enclosing indices) holding integers. Repeats nest, up
+// to META_MAX_REPEAT_DEPTH deep. Slot names starting with '@' are reserved for
+// directives.
 
-// ============================================================
+#define META_MAX_REPEAT_DEPTH 16
 
-void meta_clear_file(const char* path)
+enum
 {
-    FILE* fd = fopen(path, "w+");
-    assert(fd);
-    static const char message[] = "//File generated from template by libserg/meta.h.\n\n";
-    fwrite(message, sizeof(char), sizeof(message) - 1, fd);
-    fclose(fd);
-}
+    META_SEGMENT_LITERAL,
+    META_SEGMENT_SLOT,
+    META_SEGMENT_REPEAT,    // $<@repeat var first last>
+    META_SEGMENT_END,       // $<@end>
+};
 
 typedef struct
 {
-    char* str;
-    size_t len;
-} TemplateToken;
+    int         kind;
+    size_t      offset;  // Into MetaTemplate::source. For slots, the name between $< and >
+    size_t      len;
+    uint32_t    hash;    // Slots only. Hash of the name, so rendering never re-hashes it.
+    int         end;     // META_SEGMENT_REPEAT only. Index of the matching META_SEGMENT_END.
+} MetaSegment;
 
+// Read-only view of a whole file.
 typedef struct
 {
-    TemplateToken name;
-    TemplateToken substitution;
-} Binding;
+    const char* data;
+    size_t      size;
+#if defined(_WIN32)
+    HANDLE      file;
+    HANDLE      mapping;
+#endif
+} MetaMappedFile;
 
-void meta_expand(
-        const char* result_path,
-        const char* tmpl_path,
-        const int num_bindings,
-        ...)
+// Returns 0 if the file can't be opened. Empty files map to data == NULL, size == 0.
+int  meta_map_file(const char* path, MetaMappedFile* mapped);
+void meta_unmap_file(MetaMappedFile* mapped);
+
+typedef struct
 {
-    size_t size = 300 * 1024 * 1024;
-    void* big_block_of_memory = malloc(size);
-    Arena root_arena = arena_init(big_block_of_memory, size);
+    char*           path;
+    const char*     source;  // Points into `mapped`
+    size_t          source_len;
+    MetaSegment*    segments;
+    int             num_segments;
+    MetaMappedFile  mapped;
+} MetaTemplate;
 
-    enum
-    {
-        LEX_NOTHING,
-        LEX_DOLLAR,
-        LEX_BEGIN,
-        LEX_INSIDE,
-    };
+// Returns NULL if the template can't be read or has unbalanced directives.
+MetaTemplate* meta_template_compile(const char* tmpl_path);
 
-    // Get bindings
+// Appends to result_path. Output is the same as meta_expand with the same bindings.
+// Returns 0 if result_path can't be opened or the template can't be rendered.
+int  meta_template_render(
+        MetaTemplate* tmpl,
+        const char* result_path,
+        const int num_bindings,
+        ...);
 
-    // TODO: do a flexible stretchy array.
-    Binding* bindings = arena_array(&root_arena, Binding, 1000);
+void meta_template_free(MetaTemplate* tmpl);
 
-    va_list ap;
+// -- Bindings without va_list.
+// Names are looked up in a hash table, so there is no limit on the number of
+// bindings and each $<name> costs one probe. If a name is bound more than
+// once, the first binding wins.
 
-    va_start(ap, num_bindings);
-    for (int i = 0; i < num_bindings; ++i)
-    {
-        char* name = va_arg(ap, char*);
-        char* subst = va_arg(ap, char*);
+typedef struct
+{
+    const char* name;
+    const char* value;
+} MetaBinding;
 
-        TemplateToken tk_name = { name, strlen(name) };
-        TemplateToken tk_subst = { subst, strlen(subst) };
+// Returns 0 if the template can't be expanded or result_path can't be opened.
+int  meta_expand_bindings(
+        const char* result_path,
+        const char* tmpl_path,
+        const MetaBinding* bindings,
+        const int num_bindings);
 
-        Binding binding = { tk_name, tk_subst };
-        array_push(bindings, binding);
-    }
-    va_end(ap);
+// Returns 0 if result_path can't be opened or the template can't be rendered.
+int  meta_template_render_bindings(
+        MetaTemplate* tmpl,
+        const char* result_path,
+        const MetaBinding* bindings,
+        const int num_bindings);
 
-    FILE* out_fd = fopen(result_path, "a");
-    assert(out_fd);
-    int data_size = 0;
-    const char* in_data = slurp_file(tmpl_path, &data_size);
-    char* out_data = arena_array(&root_arena, char, 10 * 1024 * 1024);
+// -- Output sinks and batch rendering.
+// A sink is where rendered text goes: a file, a growing memory buffer, or a
+// callback. File and callback sinks go through a fixed-size write buffer.
+//
+// Usage:
+//      MetaSink sink;
+//      meta_sink_file(&sink, "vector.h");
+//      meta_template_render_batch(tmpl, &sink, sets, num_sets);
+//      meta_sink_close(&sink);
 
-    size_t path_len = strlen(tmpl_path);
-    array_push(out_data, '/'); array_push(out_data, '/');
-    for (int i = 0; i < path_len; ++i)
-    {
-        array_push(out_data, tmpl_path[i]);
-    }
-    array_push(out_data, '\n');
-    array_push(out_data, '\n');
+#define META_SINK_BUFFER_SIZE (64 * 1024)
 
-    TemplateToken* tokens = arena_array(&root_arena, TemplateToken, 5000);
+enum
+{
+    META_SINK_FILE,
+    META_SINK_MEMORY,
+    META_SINK_CALLBACK,
+};
 
-    int lexer_state = LEX_NOTHING;
+typedef void (*MetaSinkFunc)(void* user_data, const char* data, size_t len);
 
-    char prev = 0;
-    char* name = arena_array(&root_arena, char, 1000);
-    int name_len = 0;
-    for (int i = 0; i < data_size - 1; ++i)  // Don't count EOF
-    {
-        char c = in_data[i];
-        // Handle transitions
-        {
-            if ( lexer_state == LEX_NOTHING && c != '$' )
-            {
-                array_push(out_data, c);
-            }
-            if ( lexer_state == LEX_NOTHING && c == '$' )
-            {
-                lexer_state = LEX_DOLLAR;
-            }
-            else if ( lexer_state == LEX_DOLLAR && c == '<' )
-            {
-                lexer_state = LEX_INSIDE;
-            }
-            else if (lexer_state == LEX_INSIDE && c != '>')
-            {
-                // add char to name
-                array_push(name, c);
-                ++name_len;
-            }
-            else if (lexer_state == LEX_INSIDE && c == '>')
-            {
-                // add token
-                array_push(name, '\0');
-                TemplateToken token;
-                char* new_name = arena_array(&root_arena, char, strlen(name)+1);
-                strcpy(new_name, name);
-                token.str = new_name;
-                token.len = name_len;
-                array_reset(name);
-                array_push(tokens, token);
-                name_len = 0;
-                lexer_state = LEX_NOTHING;
+typedef struct
+{
+    int             type;
 
-                // Do stupid search on args to get matching subst.
-                for (int i = 0; i < array_count(bindings); ++i)
-                {
-                    const Binding binding = bindings[i];
-                    if (!strcmp(binding.name.str, token.str))
-                    {
-                        for (int j = 0; j < binding.substitution.len; ++j)
-                        {
-                            char c = binding.substitution.str[j];
-                            array_push(out_data, c);
-                        }
-                        break;
-                    }
-                }
-            }
-        }
-        prev = c;
-    }
+    FILE*           fd;         // META_SINK_FILE
 
-    array_push(out_data, '\n');
+    MetaSinkFunc    func;       // META_SINK_CALLBACK
+    void*           user_data;
 
-    fwrite(out_data, sizeof(char), array_count(out_data), out_fd);
-    fclose(out_fd);
-    free(big_block_of_memory);
-}
+    // META_SINK_MEMORY: the rendered text. For the other sinks, the write buffer.
+    char*           data;
+    size_t          count;
+    size_t          capacity;
+} MetaSink;
 
-// Note:
-//  Parser should output defines of the form
-//  #define ADCTYPE_FILE_filename_SCOPE_scope_NAME_name
-//  `scope` can be 'global' or the name of a top level function/struct/enum
-//      e.g. my_file.c has a global int variable named foo
-//      therefore we have:
-//      #define ADCTYPE_FILE_my_file_SCOPE_global_NAME_foo int
+// Opens result_path for appending. Returns 0 if the file can't be opened.
+int     meta_sink_file(MetaSink* sink, const char* result_path);
+void    meta_sink_memory(MetaSink* sink);
+void    meta_sink_callback(MetaSink* sink, MetaSinkFunc func, void* user_data);
+void    meta_sink_write(MetaSink* sink, const char* data, size_t len);
+void    meta_sink_flush(MetaSink* sink);
+// Flushes and releases the sink. Memory sinks lose their data here, so read
+// sink.data / sink.count first.
+void    meta_sink_close(MetaSink* sink);
 
+typedef struct
+{
+    const MetaBinding*  bindings;
+    int                 num_bindings;
+} MetaBindingSet;
 
-char** known_types = 0;
-char** type_decls = 0;
+// Returns 0, with the output cut short, if a $<@repeat> has bounds that aren't
+// integers.
+int  meta_template_render_sink(
+        MetaTemplate* tmpl,
+        MetaSink* sink,
+        const MetaBinding* bindings,
+        const int num_bindings);
 
+// Streaming version of meta_expand_bindings that writes into any sink.
+// Returns 0 if the template can't be read, has unbalanced directives, or has a
+// $<@repeat> with bounds that aren't integers.
+int meta_expand_sink(
+        MetaSink* sink,
+        const char* tmpl_path,
+        const MetaBinding* bindings,
+        const int num_bindings);
 
-static int is_whitespace(char c)
-{
-    if (
-            (c == ' ' ) |
-            (c == '\v') |
-            (c == '\t') |
-            (c == '\r')
-       )
-    {
-        return 1;
-    }
-    return 0;
-}
+// Renders the template once per binding set, in order, into one sink. Returns
+// 0 if any of them failed, like meta_template_render_sink.
+int  meta_template_render_batch(
+        MetaTemplate* tmpl,
+        MetaSink* sink,
+        const MetaBindingSet* sets,
+        const int num_sets);
 
-static int is_ident_char(char c)
-{
-    static char idents[] =
-    {
-        'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p',
-        'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z', 'A', 'B', 'C', 'D', 'E', 'F',
-        'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V',
-        'W', 'X', 'Y', 'Z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
-        '_',
-        '.', // We treat accessors as part of the identifier
-        ':', // special support for light c++
-    };
-    for (int i = 0; i < sizeof(idents); ++i)
-    {
-        if (c == idents[i])
-            return 1;
-    }
-    return 0;
-}
+// -- Generated files.
+// A MetaGenFile is a whole output file rendered in memory. When it is ended,
+// the file on disk is only replaced if its contents changed (written next to
+// it and renamed over it), so unchanged outputs keep their timestamps and
+// don't trigger downstream rebuilds. Every template read is recorded, to
+// write a Make-style depfile.
+//
+// Usage:
+//      MetaGenFile gen;
+//      meta_gen_begin(&gen, "vector.h");
+//      meta_gen_expand(&gen, "vector.adc", bindings, num_bindings);
+//      meta_gen_end(&gen, "vector.h.d");
 
-enum
+typedef struct
 {
-    LEX_BEGIN_LINE,
-    LEX_WAIT_FOR_NEWLINE,
-    LEX_ONE_SLASH,
-    LEX_RECEIVING,
-    LEX_INSIDE_STRING,
-    LEX_INSIDE_CHAR,
-    LEX_ASSIGN,
-};
+    const char* path;
+    MetaSink    sink;   // Memory sink with the contents of the file
+    char**      deps;   // sb_ array of template paths, copied
+} MetaGenFile;
 
-enum
-{
-    PARSE_TOP         = (1 << 0),
-    PARSE_GOT_STRUCT  = (1 << 1),
-    PARSE_IN_STRUCT   = (1 << 2),
-    PARSE_GOT_TYPEDEF = (1 << 3),
-    PARSE_ADD_TYPE    = (1 << 4),
-    PARSE_GOT_ENUM    = (1 << 5),
-    PARSE_IN_FUNC     = (1 << 6),
-};
+// Starts the file with the same header as meta_clear_file.
+void meta_gen_begin(MetaGenFile* gen, const char* result_path);
+// Returns 0 if the template can't be read or rendered.
+int  meta_gen_expand(
+        MetaGenFile* gen,
+        const char* tmpl_path,
+        const MetaBinding* bindings,
+        const int num_bindings);
+// Returns 0 if the template can't be rendered, like meta_template_render_sink.
+int  meta_gen_render(
+        MetaGenFile* gen,
+        MetaTemplate* tmpl,
+        const MetaBinding* bindings,
+        const int num_bindings);
+// Writes the file if it changed, and the depfile if depfile_path isn't NULL.
+// Returns 1 if the file was written, 0 if it was up to date, -1 on error.
+int  meta_gen_end(MetaGenFile* gen, const char* depfile_path);
+// Releases the file without writing it or its depfile, e.g. after an expansion
+// failed. The file on disk is left as it is.
+void meta_gen_discard(MetaGenFile* gen);
 
+// Returns 1 if the file was written, 0 if it already had these contents, -1 on error.
+int meta_write_if_changed(const char* path, const char* data, size_t size);
+// Writes "target: deps..." plus an empty rule per dependency, like gcc -MP,
+// so that deleting a template doesn't break the build. Returns 0 on error.
+int meta_write_depfile(const char* depfile_path, const char* target, char** deps, int num_deps);
 
-#define BUFFERSIZE (10 * 1024)
+// -- Embedded templates.
+// Templates can be compiled into the metaprogram, so that it renders from
+// static memory and never opens or lexes them. meta_embed_templates writes a
+// header with each template's bytes and pre-lexed segments; a metaprogram
+// built with that header registers them, and from then on meta_expand,
+// meta_gen_expand, meta_template_compile and job lists use the embedded copy
+// when given the same path. Output is byte-identical to reading the file.
+//
+// Usage:
+//      // Once, or whenever a template changes:
+//      const char* paths[] = { "vector.adc", "vector_ops.adc" };
+//      meta_embed_templates("templates.embed.h", paths, 2, "templates.embed.h.d");
+//
+//      // In the metaprogram:
+//      #include "templates.embed.h"
+//      meta_register_templates(meta_embedded_templates, META_NUM_EMBEDDED_TEMPLATES);
 
-static void process_file(const char* fname)
-{
-    size_t size = 300 * 1024 * 1024;
-    void* big_block_of_memory = malloc(size);
-    Arena root_arena = arena_init(big_block_of_memory, size);
+// Writes the header if it changed, and a depfile if depfile_path isn't NULL.
+// Returns 1 if the header was written, 0 if it was up to date, -1 on error.
+int meta_embed_templates(
+        const char* result_path,
+        const char** tmpl_paths,
+        const int num_templates,
+        const char* depfile_path);
 
-    int file_size;
-    const char* file_contents = slurp_file(fname, &file_size);
-    int lex_state = LEX_BEGIN_LINE;
-    int parse_state = PARSE_TOP;
+// Templates are looked up by path. They are not copied, and must stay alive
+// while the metaprogram runs. Not thread-safe: register before running jobs.
+void meta_register_templates(MetaTemplate* const* templates, const int num_templates);
 
-    char* tokenstack[BUFFERSIZE];
-    int tokencount = 0;
+// -- Job lists.
+// Queue meta_clear_file / meta_expand calls and run them on a pool of threads.
+// Jobs that write to the same file run in the order they were queued, on one
+// thread, so the output is the same as running them one after the other.
+// Jobs that use the same template share one compiled MetaTemplate.
+//
+// Paths, binding names and values are not copied: they have to stay alive
+// until meta_jobs_run returns.
+//
+// Usage:
+//      MetaJobList* jobs = meta_jobs_create();
+//      meta_jobs_clear(jobs, "vector.h");
+//      meta_jobs_expand(jobs, "vector.h", "vector.adc", vf, 3);
+//      meta_jobs_expand(jobs, "matrix.h", "matrix.adc", mf, 2);
+//      meta_jobs_run(jobs, 0);
+//      meta_jobs_free(jobs);
 
-    char* current_func = 0;  // Used for code-gen
+typedef struct MetaJobList_s MetaJobList;
 
-    if (file_contents)
-    {
+MetaJobList*    meta_jobs_create(void);
+void            meta_jobs_clear(MetaJobList* jobs, const char* result_path);
+void            meta_jobs_expand(
+                        MetaJobList* jobs,
+                        const char* result_path,
+                        const char* tmpl_path,
+                        const MetaBinding* bindings,
+                        const int num_bindings);
+// When enabled, every file that starts with meta_jobs_clear is rendered with
+// MetaGenFile: written only if it changed, with a depfile at <result_path>.d
+void            meta_jobs_write_depfiles(MetaJobList* jobs, int enabled);
+// num_threads <= 0 uses sgl_cpu_count(). Returns the number of files that
+// failed: a template didn't compile, or the file couldn't be written.
+int             meta_jobs_run(MetaJobList* jobs, int num_threads);
+void            meta_jobs_free(MetaJobList* jobs);
 
-        int brace_count = 0; // To determine if leaving function scope.
-        char** idents = 0;
-        char* curtok = arena_array(&root_arena, char, 2000);
-        char prev_c = 0;
+// -- String hash table.
+// Open addressing, power-of-two capacity. Keys are not copied: they have to
+// outlive the table.
 
-        int newtoken = 0;  // Set to one when last loop emitted an identifier.
+typedef struct
+{
+    const char* key;  // NULL for empty entries.
+    size_t      key_len;
+    uint32_t    hash;
+    void*       value;
+} MetaStrMapEntry;
 
-        for (int i = 0; i < file_size; ++i)
-        {
-            char c = file_contents[i];
+typedef struct
+{
+    MetaStrMapEntry*    entries;
+    size_t              capacity;
+    size_t              count;
+} MetaStrMap;
 
-            if (tokencount && !(parse_state & PARSE_GOT_STRUCT) &&
-                    !(parse_state & PARSE_IN_STRUCT) &&
-                    !(parse_state & PARSE_IN_FUNC) &&
-                    !strcmp(tokenstack[tokencount - 1], "struct"))
-            {
-                parse_state |= PARSE_GOT_STRUCT;
-            }
-            else if (tokencount && !(parse_state & PARSE_GOT_TYPEDEF) && !strcmp(tokenstack[tokencount - 1], "typedef"))
-            {
-                parse_state |= PARSE_GOT_TYPEDEF;
-            }
-            else if (tokencount && !(parse_state & PARSE_GOT_ENUM) && !strcmp(tokenstack[tokencount - 1], "enum"))
-            {
-                parse_state |= PARSE_GOT_ENUM;
-            }
-            ///// Check struct
-            if ((parse_state & PARSE_GOT_STRUCT) && prev_c == ';')
-            {
-                parse_state ^= PARSE_GOT_STRUCT;
-            }
-            if ((parse_state & PARSE_GOT_STRUCT) && c == '{')
-            {
-                parse_state ^= PARSE_GOT_STRUCT;
-                parse_state |= PARSE_IN_STRUCT;
-            }
-            if ((parse_state & PARSE_IN_STRUCT) && c == '}')
-            {
-                parse_state ^= PARSE_IN_STRUCT;
-            }
-            ///// check enum
-            if ((parse_state & PARSE_GOT_ENUM) && c == '}')
-            {
-                parse_state ^= PARSE_GOT_ENUM;
-            }
-            ///// check typedef (to append to known types)
-            if ((parse_state & PARSE_GOT_TYPEDEF) && !(parse_state & PARSE_IN_STRUCT) && c == ';')
-            {
-                // Please, when the token is finalized, append to known types
-                parse_state |= PARSE_ADD_TYPE;
-                parse_state ^= PARSE_GOT_TYPEDEF;
-            }
-            ///////////
-            //// check for function.
-            ///////////
-            if ((parse_state == PARSE_TOP) && c == '{')
-            {
-                char* funcname = tokenstack[tokencount - 1];
-                printf("Got function, named: %s\n", funcname);
-                current_func = funcname;
-                parse_state |= PARSE_IN_FUNC;
-                tokenstack[tokencount++] = ";";  // Anchor for doing type chencking
-            }
-            if ((parse_state & PARSE_IN_FUNC) && c == '{')
-            {
-                brace_count += 1;
-            }
-            if ((parse_state & PARSE_IN_FUNC) && c == '}')
-            {
-                brace_count -= 1;
-                if (brace_count == 0)
-                {
-                    printf("Leaving function %s.\n", current_func);
-                    current_func = 0;
-                    parse_state ^= PARSE_IN_FUNC;
-                } else
-                {
-                    tokenstack[tokencount++] = ";";  // Anchor for doing type chencking
-                }
-            }
-            ///////////
-            // HANDLE STUFF THAT SHOULD BE IGNORED
-            // ////////
-            if ( lex_state == LEX_WAIT_FOR_NEWLINE && c == '\n' )
-            {
-                lex_state = LEX_BEGIN_LINE;
-            }
-            else if ( lex_state == LEX_BEGIN_LINE && c == '#' )
-            {
-                lex_state = LEX_WAIT_FOR_NEWLINE;
-            }
-            else if ( lex_state == LEX_BEGIN_LINE && is_whitespace(c) )
-            {
-                lex_state = LEX_RECEIVING;
-            }
-            else if ( (lex_state == LEX_RECEIVING || lex_state == LEX_BEGIN_LINE) && c == '/')
-            {
-                lex_state = LEX_ONE_SLASH;
-            }
-            else if ( lex_state == LEX_ONE_SLASH && c == '/' )
-            {
-                lex_state = LEX_WAIT_FOR_NEWLINE;
-            }
-            else if (lex_state == LEX_BEGIN_LINE && c == '\n')
-            {
-                lex_state = LEX_BEGIN_LINE;
-            }
-            ////////
-            // Handle strings
-            ////////
-            else if ( (lex_state == LEX_RECEIVING || lex_state == LEX_BEGIN_LINE) && c == '\"' )
-            {
-                lex_state = LEX_INSIDE_STRING;
-            }
-            else if ( lex_state == LEX_INSIDE_STRING && c == '\"' && prev_c != '\\' )
-            {
-                lex_state = LEX_RECEIVING;
-            }
-            else if ( (lex_state == LEX_RECEIVING || lex_state == LEX_BEGIN_LINE) && c == '\'' )
-            {
-                lex_state = LEX_INSIDE_CHAR;
-            }
-            else if ( lex_state == LEX_INSIDE_CHAR && c == '\''  && prev_c != '\\' )
-            {
-                lex_state = LEX_RECEIVING;
-            }
-            ///////
-            // Assignment.
-            //////
-            else if ( (lex_state == LEX_RECEIVING || lex_state == LEX_BEGIN_LINE) && c == '=' )
-            {
-                lex_state = LEX_ASSIGN;  // Need to differentiate between assignmt and equals operator.
-            }
-            else if (tokencount &&
-                    (
-                     ((lex_state == LEX_ASSIGN && c != '='))
-                     ||
-                     ((parse_state & PARSE_IN_FUNC) && !strcmp(tokenstack[tokencount - 1], ";"))
-                    )
-                    )
-            {
-                newtoken = 0;  // reset
-                int i = tokencount;
-                char* token = tokenstack[i - 1];
-                int tokens_consumed = 0;
-                while (i)
-                {
-                    token = tokenstack[--i];
-                    int found_anchor = !strcmp(token, ";");
-                    if (!found_anchor)
-                    {
-                        array_push(type_decls, token);
-                    }
-                    else
-                    {
-                        break;
-                    }
-                    ++tokens_consumed;
-                }
-                if (tokens_consumed)
-                {
-                    //tokencount -= tokens_consumed;
-                    array_push(type_decls, current_func);
-                    array_push(type_decls, 0);
-                }
+uint32_t            meta_hash(const char* str, size_t len);
+uint64_t            meta_hash64(const char* data, size_t len);
+void                meta_strmap_init(MetaStrMap* map, size_t expected_count);
+// Returns the entry for the key, or NULL.
+MetaStrMapEntry*    meta_strmap_find(MetaStrMap* map, const char* key, size_t key_len, uint32_t hash);
+// Returns the entry for the key. Existing entries keep their value.
+MetaStrMapEntry*    meta_strmap_insert(MetaStrMap* map, const char* key, size_t key_len, uint32_t hash, void* value);
+void                meta_strmap_free(MetaStrMap* map);
 
-                if(lex_state == LEX_ASSIGN) lex_state = LEX_RECEIVING;
-            }
-            ////////
-            // parse token
-            ///////
-            if ( lex_state == LEX_RECEIVING || lex_state == LEX_BEGIN_LINE )
-            {
-                lex_state = LEX_RECEIVING;
-                if (is_ident_char(c))
-                {
-                    array_push(curtok, c);
-                }
-                else  // Finish token
-                {
-                    // Handle empty line.
-                    if (array_count(curtok))
-                    {
-                        static const char* control_flow[] =
-                        {
-                            "do", "while", "for",
-                            "if", "else",
-                        };
-                        // Filter control flow
-                        int is_control = 0;
-                        {
-                            for (int i = 0; i < sizeof(control_flow) / sizeof(char*); ++i)
-                            {
-                                if (!strcmp(curtok, control_flow[i]))
-                                {
-                                    is_control = 1;
-                                    break;
-                                }
-                            }
-                        }
-                        if (!is_control)
-                        {
-                            array_push(curtok, '\0');
-                            newtoken = 1;
-                            char* token = arena_array(&root_arena, char, array_count(curtok));
-                            strcpy(token, curtok);
-                            if (parse_state & PARSE_ADD_TYPE)
-                            {
-                                parse_state ^= PARSE_ADD_TYPE;
-                                array_push(known_types, token);
-                                printf("Typeinfo: added type %s\n", token);
-                            }
-                            if (parse_state & PARSE_GOT_STRUCT)
-                            {
-                                array_push(known_types, token);
-                                printf("Typeinfo: added struct name %s\n", token);
-                            }
-
-                            tokenstack[tokencount++] = token;
-                        }
-                    }
-                    // push semicolons
-                    if (c == ';')
-                    {
-                        tokenstack[tokencount++] = ";";
-                    }
-                    if (c == '*')
-                    {
-                        tokenstack[tokencount++] = "*";
-                    }
-                    // Reset token
-                    array_reset(curtok);
-                }
-            }
-            prev_c = c;
-        }
-    }
-    else
-    {
-        fprintf(stderr, "Could not open file for processing, %s\n", fname);
-    }
+// Searches for *.c *.h *.cpp and *.cc files in directory_path, parses them,
+// and generates type info at output_path. The results of every file are
+// cached in <output_path>.cache, and the next run only parses the files whose
+// size, modification time and contents changed. A declaration is valid if its
+// types are declared in its file or in the files it #includes "like this".
+// Files with includes that aren't under directory_path see every type.
+// Returns 1 if the output was written, 0 if it was up to date, -1 on error.
+int meta_type_info(
+        const char* output_path,
+        const char* directory_path);
 
-}
+// -- Statistics.
+// meta_type_info, meta_expand and meta_template_compile add up where their time
+// goes and what they went through, until meta_stats_reset. Times are wall
+// clock seconds; files are parsed on worker threads, and the parse phases add
+// up the time of every worker. Call these from the thread that runs the
+// generators.
 
-void meta_type_info(
-        const char* output_path,
-        const char* directory_path)
+typedef struct
 {
-    assert(output_path);
-    assert(directory_path);
+    double      walk_seconds;       // Listing directories, checking cached files
+    double      read_seconds;       // Mapping and hashing files, loading caches
+    double      lex_seconds;        // C tokens, and template segments
+    double      parse_seconds;      // Type info parser
+    double      emit_seconds;       // Type info output and cache, rendering templates
+    uint64_t    files;              // Found by type info scans
+    uint64_t    files_parsed;
+    uint64_t    templates;          // Compiled or expanded
+    uint64_t    bytes_read;         // Of the files parsed and the templates
+    uint64_t    tokens;             // C tokens and compiled template segments
+    uint64_t    declarations;       // Checked by type info
+    uint64_t    valid_declarations; // Written to type info
+    uint64_t    known_types;        // Type names declared in the scanned files
+    uint64_t    peak_arena;         // Most of the name arena one file used
+    uint64_t    peak_rss;           // Of the process, filled in by meta_stats_get
+} MetaStats;
 
-    size_t size = 300 * 1024 * 1024;
-    void* big_block_of_memory = malloc(size);
-    Arena root_arena = arena_init(big_block_of_memory, size);
+// With verbose on, the type info parser prints every file, type and function
+// it finds to stdout. Off by default.
+void    meta_set_verbose(int verbose);
+void    meta_stats_get(MetaStats* stats);
+void    meta_stats_reset(void);
+// Writes the stats as one JSON object. Returns 0 if the file can't be written.
+int     meta_stats_write_json(const char* path);
 
-    known_types = arena_array(&root_arena, char*, 3000);
-    type_decls  = arena_array(&root_arena, char*, 3000);
-    // Init known C types
-    {
-        // valid identifiers in type declarations
-        char* init_types[] =
-        {
-            "static", "const",
-            "unsigned", "char", "short", "int", "long", "float", "double",
-            "uint8_t", "uint16_t", "uint32_t", "uint64_t",
-            "int8_t", "int16_t", "int32_t", "int64_t",
-            "struct",
-            "*",
-        };
-        int count_types = (sizeof(init_types) / sizeof(char*));
-        for (int i = 0; i < count_types; ++i)
-        {
-            array_push(known_types, init_types[i]);
-        }
-    }
+#if defined(__linux__)
+// -- Watch mode.
+// Keeps compiled templates and per-file type info in memory and uses inotify
+// to regenerate only what a change affects: the outputs of a job list that use
+// a changed template, and the type info of a directory where a file changed
+// (only that file is parsed again).
+//
+// Usage:
+//      MetaWatch* watch = meta_watch_create();
+//      meta_watch_jobs(watch, jobs);  // Runs the jobs once
+//      meta_watch_type_info(watch, "types.h", "./src");
+//      for (;;) { meta_watch_poll(watch, -1); }
+//
+// Only job list outputs that start with meta_jobs_clear are regenerated, since
+// the others are appended to. The job list, and everything it points to, has
+// to outlive the watch.
 
-    FILE* fd = fopen(output_path, "w+");
-    if (!fd)
-    {
-        fprintf(stderr, "Could not open file %s for writing.\n", output_path);
-        exit(-1);
-    }
-    // Traverse directory, fill filename array
-    DIR* dirstack[256] = { 0 };
-    int dircount = 0;
+typedef struct MetaWatch_s MetaWatch;
 
-    DIR* dir = opendir(directory_path);
-    dirstack[dircount++] = dir;
-    while (dircount)
-    {
-        DIR* dir = dirstack[--dircount];
-        struct dirent* ent = readdir(dir);
-        char fname[1024];
-        while(ent)
-        {
-            fname[0] = '\0';
-            // TODO: this does not compile on OSX. FIXME
-            //strcat(fname, dir->dname);
-            fname[strlen(fname) - 1] = '\0'; // Remove * character
-            strcat(fname, ent->d_name);
+// Returns NULL if inotify is not available.
+MetaWatch*  meta_watch_create(void);
+void        meta_watch_jobs(MetaWatch* watch, MetaJobList* jobs);
+void        meta_watch_type_info(MetaWatch* watch, const char* output_path, const char* directory_path);
+// Waits up to timeout_ms (-1 for no limit) for changes, and regenerates what
+// they affect. Returns the number of outputs regenerated, or -1 on error.
+int         meta_watch_poll(MetaWatch* watch, int timeout_ms);
+void        meta_watch_free(MetaWatch* watch);
+#endif
 
-            const size_t fname_len = strlen(fname);
-            if (fname[fname_len - 1] != '.')
-            {
-                DIR* sub_dir = opendir(fname);
-                if (sub_dir)
-                {
-                    dirstack[dircount++] = sub_dir;
-                }
-                else  // Is a file.
-                {
-                    static char* acceptable_exts[] = {"cc", "cpp", "c", "h", "hh", "hpp"};
+// -- C source tokens.
+// A flat array of (kind, offset, length) into the source text. Comments are
+// dropped, and a preprocessor directive is one token spanning its whole
+// (possibly continued) line.
 
-                    int accepted = 0;
-                    { // Check that file extension is OK
-                        char* fname_ext = 0;
-                        for(size_t i = fname_len; i > 0; --i)
-                        {
-                            int c = fname[i];
-                            if (c == '.')
-                            {
-                                fname_ext = fname + i + 1;
-                                break;
-                            }
-                        }
-                        for (int i = 0; i < sizeof(acceptable_exts) / sizeof(char*); ++i)
-                        {
-                            if (!strcmp(fname_ext, acceptable_exts[i]))
-                            {
-                                accepted = 1;
-                                break;
-                            }
-                        }
+enum
+{
+    META_TOKEN_IDENT,
+    META_TOKEN_NUMBER,
+    META_TOKEN_STRING,
+    META_TOKEN_CHAR,
+    META_TOKEN_PUNCT,       // One character
+    META_TOKEN_DIRECTIVE,
+};
+
+typedef struct
+{
+    int         kind;
+    uint32_t    offset;
+    uint32_t    len;
+} MetaToken;
+
+// Returns an sb_ array of tokens. Free with meta_free_tokens.
+MetaToken*  meta_lex_c(const char* src, size_t len);
+void        meta_free_tokens(MetaToken* tokens);
+
+// -- Struct definitions.
+// Top-level `struct Tag { ... };` and `typedef struct [Tag] { ... } Name;`
+// definitions, with one entry per declared field. Nested struct/union members,
+// bit-fields and function pointers are not broken down: they set
+// `is_plain` to 0 and generators skip the struct.
+
+typedef struct
+{
+    char*   type;           // e.g. "float", "unsigned int", "const char*"
+    char*   name;
+    int     array_count;    // 0 if the field isn't an array
+} MetaField;
+
+typedef struct
+{
+    char*       name;       // Typedef name if there is one, else "struct Tag"
+    char*       tag;        // NULL for anonymous structs
+    MetaField*  fields;     // sb_
+    int         is_plain;
+} MetaStruct;
+
+// Returns an sb_ array, or NULL if the file can't be read or has no structs.
+MetaStruct*         meta_parse_structs(const char* path);
+const MetaStruct*   meta_find_struct(const MetaStruct* structs, const char* name);
+void                meta_free_structs(MetaStruct* structs);
+
+// -- Structure-of-arrays containers.
+// For a plain struct, generates <Name>SoA with one 64-byte aligned array per
+// field and _init, _free, _reserve, _push, _get, _set and _swap_remove
+// functions, e.g. for `typedef struct { float x; float y; } Particle;`:
+//
+//      ParticleSoA soa;
+//      ParticleSoA_init(&soa);
+//      ParticleSoA_push(&soa, particle);
+//      for (size_t i = 0; i < soa.count; ++i) { soa.x[i] += soa.y[i]; }
+//
+// Returns 0 if the struct isn't found or isn't plain.
+int meta_soa_sink(MetaSink* sink, const MetaStruct* def);
+// Parses source_path and appends the container for struct_name to result_path.
+int meta_soa(const char* result_path, const char* source_path, const char* struct_name);
+
+// -- Struct layouts.
+// Size, alignment, field offsets and padding of plain structs on x86-64
+// System V (LP64: long and pointers are 8 bytes, long double is 16). Field
+// types can be C's arithmetic types, <stdint.h> / <stddef.h> typedefs, enums,
+// pointers, SSE/AVX vectors and other structs of the same file.
+//
+// A field straddles a cache line if it is at most 64 bytes and crosses a
+// 64-byte boundary, with the struct starting on one. The suggested order puts
+// fields by decreasing alignment, which leaves no holes, and within the same
+// alignment picks the first field that doesn't straddle.
+
+typedef struct
+{
+    uint32_t    offset;
+    uint32_t    size;       // Arrays included
+    uint32_t    align;
+    uint32_t    padding;    // Hole after the field, up to the next one or the end
+    int         straddles;
+} MetaFieldLayout;
+
+typedef struct
+{
+    uint32_t            size;
+    uint32_t            align;
+    uint32_t            padding;        // All the holes, the tail included
+    int                 num_straddling;
+    MetaFieldLayout*    fields;         // One per field, in declaration order
+    // Field indices in the suggested order, or NULL if it wouldn't be smaller
+    // or straddle fewer cache lines.
+    int*                order;
+    uint32_t            suggested_size;
+    int                 suggested_straddling;
+    const char*         unknown_type;   // The field type that couldn't be sized, if any
+} MetaStructLayout;
+
+// Returns 0 if the struct isn't plain or a field type isn't known.
+int     meta_struct_layout(const MetaStruct* structs, const MetaStruct* def, MetaStructLayout* layout);
+void    meta_free_struct_layout(MetaStructLayout* layout);
+// Writes a table per struct as comments, the suggested order, and
+// _Static_assert checks of sizeof and offsetof for x86-64 System V builds.
+void    meta_struct_layout_sink(MetaSink* sink, const MetaStruct* structs);
+// Parses source_path and appends the report for all its structs to result_path.
+int     meta_struct_layout_report(const char* result_path, const char* source_path);
+
+// -- Binary serialization.
+// For a plain struct with no pointers, all the way down, generates a schema
+// hash and functions that store arrays of it as they are in memory, e.g. for
+// Particle:
+//
+//      size_t size = Particle_serial_size(count);
+//      Particle_serial_write(buffer, particles, count);
+//      ...
+//      size_t count;
+//      const Particle* in_place = Particle_serial_view(mapped, size, &count);
+//
+// The buffer is a 32-byte header ("ADCS", element size, schema, count,
+// header size) followed by the elements, so a mapped file can be used with no
+// decoding. Holes, those inside nested structs too, are written as zeros. The
+// schema is a hash of the field names, types, offsets and sizes on x86-64
+// System V, and _view returns NULL for buffers written with another layout, or
+// another byte order.
+int meta_serial_sink(MetaSink* sink, const MetaStruct* structs, const MetaStruct* def);
+// Parses source_path and appends the functions for struct_name, or for every
+// struct they can be made for if it is NULL, to result_path.
+int meta_serial(const char* result_path, const char* source_path, const char* struct_name);
+
+// -- Enum definitions.
+// Top-level `enum Tag { ... };` and `typedef enum [Tag] { ... } Name;`
+// definitions. Values are worked out when every enumerator is implicit, an
+// integer literal or an earlier enumerator; otherwise `values_known` is 0.
+// Enums with directives inside set `is_plain` to 0 and generators skip them.
+
+typedef struct
+{
+    char*       name;
+    long long   value;          // Only if the enum's values_known is set
+} MetaEnumerator;
+
+typedef struct
+{
+    char*           name;       // Typedef name if there is one, else "enum Tag"
+    char*           tag;        // NULL for anonymous enums
+    MetaEnumerator* values;     // sb_, in declaration order
+    int             values_known;
+    int             is_plain;
+} MetaEnum;
+
+// Returns an sb_ array, or NULL if the file can't be read or has no enums.
+MetaEnum*       meta_parse_enums(const char* path);
+const MetaEnum* meta_find_enum(const MetaEnum* enums, const char* name);
+void            meta_free_enums(MetaEnum* enums);
+
+// -- Perfect hash lookups.
+// For a fixed set of distinct strings, finds a minimal perfect hash: every
+// string gets its own slot in a table of exactly as many entries, so a lookup
+// hashes the key once and compares it with one string. For "get", "put" and
+// "delete" named Method:
+//
+//      int i = Method_lookup(str, len);    // Index in Method_strings, or -1
+//
+// Strings are split into buckets by hash, biggest buckets first, and each
+// bucket gets the first seed that sends all its strings to free slots (CHD).
+// Returns 0 for an empty set or duplicates.
+int meta_perfect_hash_sink(MetaSink* sink, const char* name, const char* const* strings, int num_strings);
+// Appends the lookup to result_path.
+int meta_perfect_hash(const char* result_path, const char* name, const char* const* strings, int num_strings);
+// For an enum, the lookup over its enumerator names, and
+//
+//      const char* Color_to_string(Color value);      // NULL if it isn't an enumerator
+//      int         Color_from_string(const char* str, size_t len, Color* value);
+//
+// _to_string indexes the names when the values are 0..n-1 and switches on
+// them otherwise. Aliases get the first name with their value.
+int meta_enum_strings_sink(MetaSink* sink, const MetaEnum* def);
+// Parses source_path and appends the functions for enum_name, or for all its
+// enums if it is NULL, to result_path.
+int meta_enum_strings(const char* result_path, const char* source_path, const char* enum_name);
+
+// ============================================================
+
+// Peak resident memory of the process in bytes, or 0 if it isn't known.
+static size_t meta__peak_rss()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return (size_t)usage.ru_maxrss;         // Bytes
+#else
+    return (size_t)usage.ru_maxrss * 1024;  // Kilobytes
+#endif
+#endif
+}
+
+// Size and modification time of a file. Returns 0 if it can't be read.
+static int meta__file_stat(const char* path, uint64_t* size, uint64_t* mtime)
+{
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+    {
+        return 0;
+    }
+    *size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    *mtime = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0)
+    {
+        return 0;
+    }
+    *size = (uint64_t)st.st_size;
+#if defined(__APPLE__)
+    *mtime = (uint64_t)st.st_mtimespec.tv_sec * 1000000000ull + (uint64_t)st.st_mtimespec.tv_nsec;
+#else
+    *mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+#endif
+#endif
+    return 1;
+}
+
+static const char meta__clear_message[] = "//File generated from template by libserg/meta.h.\n\n";
+
+void meta_clear_file(const char* path)
+{
+    FILE* fd = fopen(path, "w+");
+    assert(fd);
+    fwrite(meta__clear_message, sizeof(char), sizeof(meta__clear_message) - 1, fd);
+    fclose(fd);
+}
+
+int meta_map_file(const char* path, MetaMappedFile* mapped)
+{
+    memset(mapped, 0, sizeof(MetaMappedFile));
+#if defined(_WIN32)
+    mapped->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mapped->file == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(mapped->file, &size);
+    mapped->size = (size_t)size.QuadPart;
+    if (mapped->size)
+    {
+        mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        mapped->data = mapped->mapping ?
+                (const char*)MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (!mapped->data)
+        {
+            meta_unmap_file(mapped);
+            return 0;
+        }
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+    mapped->size = (size_t)st.st_size;
+    if (mapped->size)
+    {
+        void* data = mmap(NULL, mapped->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            memset(mapped, 0, sizeof(MetaMappedFile));
+            return 0;
+        }
+        mapped->data = (const char*)data;
+    }
+    close(fd);  // The mapping keeps its own reference.
+#endif
+    return 1;
+}
+
+void meta_unmap_file(MetaMappedFile* mapped)
+{
+#if defined(_WIN32)
+    if (mapped->data)
+    {
+        UnmapViewOfFile(mapped->data);
+    }
+    if (mapped->mapping)
+    {
+        CloseHandle(mapped->mapping);
+    }
+    if (mapped->file && mapped->file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mapped->file);
+    }
+#else
+    if (mapped->data)
+    {
+        munmap((void*)mapped->data, mapped->size);
+    }
+#endif
+    memset(mapped, 0, sizeof(MetaMappedFile));
+}
+
+uint32_t meta_hash(const char* str, size_t len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+    {
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint64_t meta_hash64(const char* data, size_t len)
+{
+    // FNV-1a, 64 bit
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; ++i)
+    {
+        hash ^= (uint8_t)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void meta_strmap_init(MetaStrMap* map, size_t expected_count)
+{
+    size_t capacity = 16;
+    while (capacity < 2 * expected_count)
+    {
+        capacity *= 2;
+    }
+    map->entries = (MetaStrMapEntry*)calloc(capacity, sizeof(MetaStrMapEntry));
+    assert(map->entries);
+    map->capacity = capacity;
+    map->count = 0;
+}
+
+static MetaStrMapEntry* meta__strmap_probe(
+        MetaStrMapEntry* entries,
+        size_t capacity,
+        const char* key,
+        size_t key_len,
+        uint32_t hash)
+{
+    size_t mask = capacity - 1;
+    size_t i = hash & mask;
+    for (;;)
+    {
+        MetaStrMapEntry* entry = &entries[i];
+        if (!entry->key ||
+            (entry->hash == hash && entry->key_len == key_len && !memcmp(entry->key, key, key_len)))
+        {
+            return entry;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+MetaStrMapEntry* meta_strmap_find(MetaStrMap* map, const char* key, size_t key_len, uint32_t hash)
+{
+    MetaStrMapEntry* entry = meta__strmap_probe(map->entries, map->capacity, key, key_len, hash);
+    return entry->key ? entry : NULL;
+}
+
+MetaStrMapEntry* meta_strmap_insert(MetaStrMap* map, const char* key, size_t key_len, uint32_t hash, void* value)
+{
+    // Keep the load factor under 1/2
+    if (2 * (map->count + 1) > map->capacity)
+    {
+        size_t capacity = map->capacity * 2;
+        MetaStrMapEntry* entries = (MetaStrMapEntry*)calloc(capacity, sizeof(MetaStrMapEntry));
+        assert(entries);
+        for (size_t i = 0; i < map->capacity; ++i)
+        {
+            MetaStrMapEntry* old = &map->entries[i];
+            if (old->key)
+            {
+                *meta__strmap_probe(entries, capacity, old->key, old->key_len, old->hash) = *old;
+            }
+        }
+        free(map->entries);
+        map->entries = entries;
+        map->capacity = capacity;
+    }
+    MetaStrMapEntry* entry = meta__strmap_probe(map->entries, map->capacity, key, key_len, hash);
+    if (!entry->key)
+    {
+        entry->key = key;
+        entry->key_len = key_len;
+        entry->hash = hash;
+        entry->value = value;
+        ++map->count;
+    }
+    return entry;
+}
+
+void meta_strmap_free(MetaStrMap* map)
+{
+    free(map->entries);
+    memset(map, 0, sizeof(MetaStrMap));
+}
+
+typedef struct
+{
+    const char* str;
+    size_t len;
+} TemplateToken;
+
+// Binding names interned in a hash table. Each value points into `substitutions`.
+typedef struct
+{
+    MetaStrMap      names;
+    TemplateToken*  substitutions;
+    int             capacity;
+} BindingTable;
+
+// Fills the table, reusing its memory when it was already loaded with another
+// binding set.
+static void meta__binding_table_load(BindingTable* table, const MetaBinding* bindings, const int num_bindings)
+{
+    if (!table->names.entries)
+    {
+        meta_strmap_init(&table->names, num_bindings);
+    }
+    else
+    {
+        memset(table->names.entries, 0, table->names.capacity * sizeof(MetaStrMapEntry));
+        table->names.count = 0;
+    }
+    if (num_bindings > table->capacity)
+    {
+        free(table->substitutions);
+        table->substitutions = (TemplateToken*)malloc(num_bindings * sizeof(TemplateToken));
+        assert(table->substitutions);
+        table->capacity = num_bindings;
+    }
+    for (int i = 0; i < num_bindings; ++i)
+    {
+        TemplateToken subst = { bindings[i].value, strlen(bindings[i].value) };
+        table->substitutions[i] = subst;
+
+        size_t name_len = strlen(bindings[i].name);
+        meta_strmap_insert(&table->names, bindings[i].name, name_len,
+                           meta_hash(bindings[i].name, name_len), &table->substitutions[i]);
+    }
+}
+
+static const TemplateToken* meta__binding_table_find(BindingTable* table, const char* name, size_t len, uint32_t hash)
+{
+    MetaStrMapEntry* entry = meta_strmap_find(&table->names, name, len, hash);
+    return entry ? (const TemplateToken*)entry->value : NULL;
+}
+
+static void meta__binding_table_free(BindingTable* table)
+{
+    meta_strmap_free(&table->names);
+    free(table->substitutions);
+    memset(table, 0, sizeof(BindingTable));
+}
+
+static MetaBinding* meta__bindings_from_va(const int num_bindings, va_list ap)
+{
+    MetaBinding* bindings = (MetaBinding*)malloc((num_bindings + 1) * sizeof(MetaBinding));
+    assert(bindings);
+    for (int i = 0; i < num_bindings; ++i)
+    {
+        bindings[i].name = va_arg(ap, char*);
+        bindings[i].value = va_arg(ap, char*);
+    }
+    return bindings;
+}
+
+int meta_sink_file(MetaSink* sink, const char* result_path)
+{
+    memset(sink, 0, sizeof(MetaSink));
+    sink->type = META_SINK_FILE;
+    sink->fd = fopen(result_path, "a");
+    if (!sink->fd)
+    {
+        fprintf(stderr, "Could not open file %s for writing.\n", result_path);
+        return 0;
+    }
+    sink->capacity = META_SINK_BUFFER_SIZE;
+    sink->data = (char*)malloc(sink->capacity);
+    assert(sink->data);
+    return 1;
+}
+
+void meta_sink_memory(MetaSink* sink)
+{
+    memset(sink, 0, sizeof(MetaSink));
+    sink->type = META_SINK_MEMORY;
+}
+
+void meta_sink_callback(MetaSink* sink, MetaSinkFunc func, void* user_data)
+{
+    memset(sink, 0, sizeof(MetaSink));
+    sink->type = META_SINK_CALLBACK;
+    sink->func = func;
+    sink->user_data = user_data;
+    sink->capacity = META_SINK_BUFFER_SIZE;
+    sink->data = (char*)malloc(sink->capacity);
+    assert(sink->data);
+}
+
+static void meta__sink_emit(MetaSink* sink, const char* data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    if (sink->type == META_SINK_FILE)
+    {
+        fwrite(data, sizeof(char), len, sink->fd);
+    }
+    else if (sink->type == META_SINK_CALLBACK)
+    {
+        sink->func(sink->user_data, data, len);
+    }
+}
+
+void meta_sink_flush(MetaSink* sink)
+{
+    if (sink->type != META_SINK_MEMORY)
+    {
+        meta__sink_emit(sink, sink->data, sink->count);
+        sink->count = 0;
+    }
+}
+
+void meta_sink_write(MetaSink* sink, const char* data, size_t len)
+{
+    if (sink->count + len > sink->capacity)
+    {
+        if (sink->type == META_SINK_MEMORY)
+        {
+            size_t capacity = sink->capacity ? sink->capacity : 4096;
+            while (capacity < sink->count + len)
+            {
+                capacity *= 2;
+            }
+            sink->data = (char*)realloc(sink->data, capacity);
+            assert(sink->data);
+            sink->capacity = capacity;
+        }
+        else
+        {
+            meta_sink_flush(sink);
+            // Don't copy writes that wouldn't fit anyway.
+            if (len > sink->capacity)
+            {
+                meta__sink_emit(sink, data, len);
+                return;
+            }
+        }
+    }
+    memcpy(sink->data + sink->count, data, len);
+    sink->count += len;
+}
+
+void meta_sink_close(MetaSink* sink)
+{
+    meta_sink_flush(sink);
+    if (sink->fd)
+    {
+        fclose(sink->fd);
+    }
+    free(sink->data);
+    memset(sink, 0, sizeof(MetaSink));
+}
+
+#if defined(META_SCALAR_LEXER) || defined(META_BENCH)
+// Reference lexer. One state transition per byte. Only built when it is used:
+// as the lexer, or by meta_bench.c to check the SIMD one.
+static int meta__lex_template_scalar(const char* src, size_t len, MetaSegment* segments)
+{
+    enum
+    {
+        LEX_NOTHING,
+        LEX_DOLLAR,
+        LEX_INSIDE,
+    };
+
+    int lexer_state = LEX_NOTHING;
+    int num_segments = 0;
+    size_t literal_begin = 0;
+    size_t name_begin = 0;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        char c = src[i];
+        if ( lexer_state == LEX_NOTHING && c == '$' )
+        {
+            if (i > literal_begin)
+            {
+                if (segments)
+                {
+                    MetaSegment segment = { META_SEGMENT_LITERAL, literal_begin, i - literal_begin, 0, 0 };
+                    segments[num_segments] = segment;
+                }
+                ++num_segments;
+            }
+            lexer_state = LEX_DOLLAR;
+        }
+        else if ( lexer_state == LEX_DOLLAR && c == '<' )
+        {
+            name_begin = i + 1;
+            lexer_state = LEX_INSIDE;
+        }
+        else if ( lexer_state == LEX_INSIDE && c == '>' )
+        {
+            if (segments)
+            {
+                MetaSegment segment = { META_SEGMENT_SLOT, name_begin, i - name_begin,
+                                        meta_hash(src + name_begin, i - name_begin), 0 };
+                segments[num_segments] = segment;
+            }
+            ++num_segments;
+            literal_begin = i + 1;
+            lexer_state = LEX_NOTHING;
+        }
+    }
+    // Anything after an unterminated $< is dropped, same as the old lexer.
+    if (lexer_state == LEX_NOTHING && len > literal_begin)
+    {
+        if (segments)
+        {
+            MetaSegment segment = { META_SEGMENT_LITERAL, literal_begin, len - literal_begin, 0, 0 };
+            segments[num_segments] = segment;
+        }
+        ++num_segments;
+    }
+    return num_segments;
+}
+#endif
+
+static int meta__ctz(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Returns the first c in [p, end), or NULL.
+static const char* meta__find_byte(const char* p, const char* end, char c)
+{
+#if defined(META_AVX2)
+    const __m256i needle32 = _mm256_set1_epi8(c);
+    while (end - p >= 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle32));
+        if (mask)
+        {
+            return p + meta__ctz(mask);
+        }
+        p += 32;
+    }
+#endif
+#if defined(META_SSE2)
+    const __m128i needle16 = _mm_set1_epi8(c);
+    while (end - p >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle16));
+        if (mask)
+        {
+            return p + meta__ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    if (p >= end)
+    {
+        return NULL;
+    }
+    return (const char*)memchr(p, c, (size_t)(end - p));
+}
+
+// Produces the segment that starts at *pos and moves *pos past it. Returns 0
+// at the end of the template. Gives the same segments as
+// meta__lex_template_scalar, but it jumps from '$' to '$', so literal runs are
+// never looked at byte by byte.
+static int meta__lex_next(const char* src, size_t len, size_t* pos, MetaSegment* segment)
+{
+    const char* end = src + len;
+    size_t begin = *pos;
+    if (begin >= len)
+    {
+        return 0;
+    }
+
+    const char* dollar = meta__find_byte(src + begin, end, '$');
+    size_t literal_end = dollar ? (size_t)(dollar - src) : len;
+    if (literal_end > begin)
+    {
+        MetaSegment literal = { META_SEGMENT_LITERAL, begin, literal_end - begin, 0, 0 };
+        *segment = literal;
+        *pos = literal_end;
+        return 1;
+    }
+
+    // Like the scalar lexer, whatever is between '$' and '<' is skipped, and
+    // an unterminated slot drops the rest of the template.
+    const char* open = meta__find_byte(dollar + 1, end, '<');
+    const char* close = open ? meta__find_byte(open + 1, end, '>') : NULL;
+    if (!close)
+    {
+        *pos = len;
+        return 0;
+    }
+    size_t name_begin = (size_t)(open + 1 - src);
+    size_t name_len = (size_t)(close - open - 1);
+    MetaSegment slot = { META_SEGMENT_SLOT, name_begin, name_len, meta_hash(src + name_begin, name_len), 0 };
+    *segment = slot;
+    *pos = (size_t)(close + 1 - src);
+    return 1;
+}
+
+#if !defined(META_SCALAR_LEXER) || defined(META_BENCH)
+static int meta__lex_template_fast(const char* src, size_t len, MetaSegment* segments)
+{
+    int num_segments = 0;
+    size_t pos = 0;
+    MetaSegment segment;
+    while (meta__lex_next(src, len, &pos, &segment))
+    {
+        if (segments)
+        {
+            segments[num_segments] = segment;
+        }
+        ++num_segments;
+    }
+    return num_segments;
+}
+#endif
+
+static int meta__lex_template(const char* src, size_t len, MetaSegment* segments)
+{
+#if defined(META_SCALAR_LEXER)
+    return meta__lex_template_scalar(src, len, segments);
+#else
+    return meta__lex_template_fast(src, len, segments);
+#endif
+}
+
+// ==== Statistics
+
+static MetaStats meta__stats;
+static int meta__verbose;
+
+// Seconds on a monotonic clock.
+static double meta__now()
+{
+#if defined(_WIN32)
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Workers count into their own MetaStats and add it here once, under a lock.
+static void meta__stats_add(MetaStats* to, const MetaStats* from)
+{
+    to->walk_seconds += from->walk_seconds;
+    to->read_seconds += from->read_seconds;
+    to->lex_seconds += from->lex_seconds;
+    to->parse_seconds += from->parse_seconds;
+    to->emit_seconds += from->emit_seconds;
+    to->files += from->files;
+    to->files_parsed += from->files_parsed;
+    to->templates += from->templates;
+    to->bytes_read += from->bytes_read;
+    to->tokens += from->tokens;
+    to->declarations += from->declarations;
+    to->valid_declarations += from->valid_declarations;
+    to->known_types += from->known_types;
+    if (from->peak_arena > to->peak_arena)
+    {
+        to->peak_arena = from->peak_arena;
+    }
+}
+
+void meta_set_verbose(int verbose)
+{
+    meta__verbose = verbose;
+}
+
+void meta_stats_get(MetaStats* stats)
+{
+    *stats = meta__stats;
+    stats->peak_rss = meta__peak_rss();
+}
+
+void meta_stats_reset(void)
+{
+    memset(&meta__stats, 0, sizeof(MetaStats));
+}
+
+int meta_stats_write_json(const char* path)
+{
+    MetaStats stats;
+    meta_stats_get(&stats);
+    FILE* fd = fopen(path, "w");
+    if (!fd)
+    {
+        fprintf(stderr, "Could not open file %s for writing.\n", path);
+        return 0;
+    }
+    fprintf(fd,
+            "{\n"
+            "    \"walk_seconds\": %.6f,\n"
+            "    \"read_seconds\": %.6f,\n"
+            "    \"lex_seconds\": %.6f,\n"
+            "    \"parse_seconds\": %.6f,\n"
+            "    \"emit_seconds\": %.6f,\n",
+            stats.walk_seconds, stats.read_seconds, stats.lex_seconds, stats.parse_seconds, stats.emit_seconds);
+    fprintf(fd,
+            "    \"files\": %llu,\n"
+            "    \"files_parsed\": %llu,\n"
+            "    \"templates\": %llu,\n"
+            "    \"bytes_read\": %llu,\n"
+            "    \"tokens\": %llu,\n"
+            "    \"declarations\": %llu,\n"
+            "    \"valid_declarations\": %llu,\n"
+            "    \"known_types\": %llu,\n"
+            "    \"peak_arena\": %llu,\n"
+            "    \"peak_rss\": %llu\n"
+            "}\n",
+            (unsigned long long)stats.files, (unsigned long long)stats.files_parsed,
+            (unsigned long long)stats.templates, (unsigned long long)stats.bytes_read,
+            (unsigned long long)stats.tokens, (unsigned long long)stats.declarations,
+            (unsigned long long)stats.valid_declarations, (unsigned long long)stats.known_types,
+            (unsigned long long)stats.peak_arena, (unsigned long long)stats.peak_rss);
+    int ok = !ferror(fd);
+    ok &= fclose(fd) == 0;
+    return ok;
+}
+
+// ==== Embedded templates
+
+// Registered templates by path.
+static MetaStrMap meta__embedded;
+
+void meta_register_templates(MetaTemplate* const* templates, const int num_templates)
+{
+    if (!meta__embedded.entries)
+    {
+        meta_strmap_init(&meta__embedded, num_templates);
+    }
+    for (int i = 0; i < num_templates; ++i)
+    {
+        const char* path = templates[i]->path;
+        size_t len = strlen(path);
+        meta_strmap_insert(&meta__embedded, path, len, meta_hash(path, len), templates[i]);
+    }
+}
+
+static MetaTemplate* meta__find_embedded(const char* tmpl_path)
+{
+    if (!meta__embedded.count)
+    {
+        return NULL;
+    }
+    size_t len = strlen(tmpl_path);
+    MetaStrMapEntry* entry = meta_strmap_find(&meta__embedded, tmpl_path, len, meta_hash(tmpl_path, len));
+    return entry ? (MetaTemplate*)entry->value : NULL;
+}
+
+// -- Directives
+
+// An index bound by an enclosing $<@repeat>. `text` is the index formatted for substitution.
+typedef struct
+{
+    const char* var;
+    size_t      var_len;
+    char        text[24];
+    size_t      text_len;
+} RepeatFrame;
+
+static int meta__directive_kind(const char* name, size_t len)
+{
+    if (len == 0 || name[0] != '@')
+    {
+        return META_SEGMENT_SLOT;
+    }
+    if (len == 4 && !memcmp(name, "@end", 4))
+    {
+        return META_SEGMENT_END;
+    }
+    if (len > 7 && !memcmp(name, "@repeat", 7) && (name[7] == ' ' || name[7] == '\t'))
+    {
+        return META_SEGMENT_REPEAT;
+    }
+    return -1;
+}
+
+// Splits "@repeat var first last" into its three arguments.
+static int meta__parse_repeat(const char* name, size_t len, TemplateToken args[3])
+{
+    size_t i = 7;
+    int num_args = 0;
+    while (i < len)
+    {
+        if (name[i] == ' ' || name[i] == '\t' || name[i] == '\n' || name[i] == '\r')
+        {
+            ++i;
+            continue;
+        }
+        size_t begin = i;
+        while (i < len && name[i] != ' ' && name[i] != '\t' && name[i] != '\n' && name[i] != '\r')
+        {
+            ++i;
+        }
+        if (num_args == 3)
+        {
+            return 0;
+        }
+        TemplateToken arg = { name + begin, i - begin };
+        args[num_args++] = arg;
+    }
+    return num_args == 3;
+}
+
+static int meta__parse_int(const char* str, size_t len, long* value)
+{
+    size_t i = 0;
+    int negative = 0;
+    if (i < len && str[i] == '-')
+    {
+        negative = 1;
+        ++i;
+    }
+    if (i == len)
+    {
+        return 0;
+    }
+    long result = 0;
+    for (; i < len; ++i)
+    {
+        if (str[i] < '0' || str[i] > '9')
+        {
+            return 0;
+        }
+        result = result * 10 + (str[i] - '0');
+    }
+    *value = negative ? -result : result;
+    return 1;
+}
+
+// Repeat indices shadow bindings, and inner indices shadow outer ones.
+static int meta__lookup(
+        BindingTable* table,
+        const RepeatFrame* frames,
+        int depth,
+        const char* name,
+        size_t len,
+        uint32_t hash,
+        TemplateToken* subst)
+{
+    for (int i = depth - 1; i >= 0; --i)
+    {
+        if (frames[i].var_len == len && !memcmp(frames[i].var, name, len))
+        {
+            subst->str = frames[i].text;
+            subst->len = frames[i].text_len;
+            return 1;
+        }
+    }
+    const TemplateToken* found = meta__binding_table_find(table, name, len, hash);
+    if (found)
+    {
+        *subst = *found;
+        return 1;
+    }
+    return 0;
+}
+
+// Evaluates the bounds of a $<@repeat>. Returns 0, after printing why, if they
+// aren't integers.
+static int meta__repeat_range(
+        const char* name,
+        size_t len,
+        BindingTable* table,
+        const RepeatFrame* frames,
+        int depth,
+        TemplateToken* var,
+        long* first,
+        long* last)
+{
+    TemplateToken args[3];
+    if (!meta__parse_repeat(name, len, args))
+    {
+        fprintf(stderr, "Expected $<@repeat var first last>, got $<%.*s>\n", (int)len, name);
+        return 0;
+    }
+    *var = args[0];
+    long* bounds[2] = { first, last };
+    for (int i = 0; i < 2; ++i)
+    {
+        const TemplateToken* arg = &args[i + 1];
+        if (meta__parse_int(arg->str, arg->len, bounds[i]))
+        {
+            continue;
+        }
+        TemplateToken value;
+        if (!meta__lookup(table, frames, depth, arg->str, arg->len, meta_hash(arg->str, arg->len), &value))
+        {
+            fprintf(stderr, "Repeat bound %.*s is not bound\n", (int)arg->len, arg->str);
+            return 0;
+        }
+        if (!meta__parse_int(value.str, value.len, bounds[i]))
+        {
+            fprintf(stderr, "Repeat bound %.*s is not an integer: %.*s\n",
+                    (int)arg->len, arg->str, (int)value.len, value.str);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void meta__repeat_frame(RepeatFrame* frame, const TemplateToken* var, long index)
+{
+    frame->var = var->str;
+    frame->var_len = var->len;
+    frame->text_len = (size_t)snprintf(frame->text, sizeof(frame->text), "%ld", index);
+}
+
+// Turns directive slots into META_SEGMENT_REPEAT / META_SEGMENT_END and links
+// each repeat to its end.
+static int meta__link_directives(const char* tmpl_path, const char* source, MetaSegment* segments, int num_segments)
+{
+    int open[META_MAX_REPEAT_DEPTH];
+    int depth = 0;
+    for (int i = 0; i < num_segments; ++i)
+    {
+        MetaSegment* segment = &segments[i];
+        if (segment->kind != META_SEGMENT_SLOT)
+        {
+            continue;
+        }
+        const char* name = source + segment->offset;
+        int kind = meta__directive_kind(name, segment->len);
+        if (kind == META_SEGMENT_REPEAT)
+        {
+            TemplateToken args[3];
+            if (!meta__parse_repeat(name, segment->len, args))
+            {
+                fprintf(stderr, "%s: expected $<@repeat var first last>, got $<%.*s>\n",
+                        tmpl_path, (int)segment->len, name);
+                return 0;
+            }
+            if (depth == META_MAX_REPEAT_DEPTH)
+            {
+                fprintf(stderr, "%s: repeats nested deeper than %d\n", tmpl_path, META_MAX_REPEAT_DEPTH);
+                return 0;
+            }
+            open[depth++] = i;
+        }
+        else if (kind == META_SEGMENT_END)
+        {
+            if (depth == 0)
+            {
+                fprintf(stderr, "%s: $<@end> without $<@repeat>\n", tmpl_path);
+                return 0;
+            }
+            segments[open[--depth]].end = i;
+        }
+        else if (kind < 0)
+        {
+            fprintf(stderr, "%s: unknown directive $<%.*s>\n", tmpl_path, (int)segment->len, name);
+            return 0;
+        }
+        segment->kind = kind;
+    }
+    if (depth)
+    {
+        fprintf(stderr, "%s: $<@repeat> without $<@end>\n", tmpl_path);
+        return 0;
+    }
+    return 1;
+}
+
+static MetaTemplate* meta__template_compile_file(const char* tmpl_path)
+{
+    double start = meta__now();
+    MetaMappedFile mapped;
+    if (!meta_map_file(tmpl_path, &mapped))
+    {
+        fprintf(stderr, "Could not open template %s\n", tmpl_path);
+        return NULL;
+    }
+    double read_end = meta__now();
+
+    MetaTemplate* tmpl = (MetaTemplate*)calloc(1, sizeof(MetaTemplate));
+    assert(tmpl);
+
+    size_t path_len = strlen(tmpl_path);
+    tmpl->path = (char*)malloc(path_len + 1);
+    assert(tmpl->path);
+    memcpy(tmpl->path, tmpl_path, path_len + 1);
+
+    tmpl->mapped = mapped;
+    tmpl->source = mapped.data;
+    tmpl->source_len = mapped.size;
+
+    // Count first, so that the segment array is allocated exactly once.
+    tmpl->num_segments = meta__lex_template(tmpl->source, tmpl->source_len, NULL);
+    tmpl->segments = (MetaSegment*)malloc((tmpl->num_segments + 1) * sizeof(MetaSegment));
+    assert(tmpl->segments);
+    meta__lex_template(tmpl->source, tmpl->source_len, tmpl->segments);
+    meta__stats.read_seconds += read_end - start;
+    meta__stats.lex_seconds += meta__now() - read_end;
+    meta__stats.templates += 1;
+    meta__stats.bytes_read += mapped.size;
+    meta__stats.tokens += (uint64_t)tmpl->num_segments;
+
+    if (!meta__link_directives(tmpl->path, tmpl->source, tmpl->segments, tmpl->num_segments))
+    {
+        meta_template_free(tmpl);
+        return NULL;
+    }
+
+    return tmpl;
+}
+
+MetaTemplate* meta_template_compile(const char* tmpl_path)
+{
+    MetaTemplate* embedded = meta__find_embedded(tmpl_path);
+    if (embedded)
+    {
+        // Same as compiling it, minus the I/O and lexing. The source stays in
+        // static memory; nothing is mapped.
+        MetaTemplate* tmpl = (MetaTemplate*)calloc(1, sizeof(MetaTemplate));
+        assert(tmpl);
+        *tmpl = *embedded;
+        size_t path_len = strlen(tmpl_path);
+        tmpl->path = (char*)malloc(path_len + 1);
+        assert(tmpl->path);
+        memcpy(tmpl->path, tmpl_path, path_len + 1);
+        tmpl->segments = (MetaSegment*)malloc((tmpl->num_segments + 1) * sizeof(MetaSegment));
+        assert(tmpl->segments);
+        memcpy(tmpl->segments, embedded->segments, tmpl->num_segments * sizeof(MetaSegment));
+        return tmpl;
+    }
+
+    return meta__template_compile_file(tmpl_path);
+}
+
+static void meta__render_segment(
+        MetaSink* sink,
+        const char* source,
+        const MetaSegment* segment,
+        BindingTable* table,
+        const RepeatFrame* frames,
+        int depth)
+{
+    if (segment->kind == META_SEGMENT_LITERAL)
+    {
+        meta_sink_write(sink, source + segment->offset, segment->len);
+    }
+    else
+    {
+        TemplateToken subst;
+        if (meta__lookup(table, frames, depth, source + segment->offset, segment->len, segment->hash, &subst))
+        {
+            meta_sink_write(sink, subst.str, subst.len);
+        }
+    }
+}
+
+static void meta__render_header(MetaSink* sink, const char* tmpl_path)
+{
+    meta_sink_write(sink, "//", 2);
+    meta_sink_write(sink, tmpl_path, strlen(tmpl_path));
+    meta_sink_write(sink, "\n\n", 2);
+}
+
+// Renders segments [first, last). Repeat bodies are rendered recursively and
+// skipped over. Returns 0 if the bounds of a repeat aren't integers.
+static int meta__render_segments(
+        MetaTemplate* tmpl,
+        MetaSink* sink,
+        BindingTable* table,
+        int first,
+        int last,
+        RepeatFrame* frames,
+        int depth)
+{
+    for (int i = first; i < last; ++i)
+    {
+        const MetaSegment* segment = &tmpl->segments[i];
+        if (segment->kind != META_SEGMENT_REPEAT)
+        {
+            meta__render_segment(sink, tmpl->source, segment, table, frames, depth);
+            continue;
+        }
+        TemplateToken var;
+        long begin, end;
+        if (!meta__repeat_range(tmpl->source + segment->offset, segment->len, table, frames, depth,
+                                &var, &begin, &end))
+        {
+            return 0;
+        }
+        for (long index = begin; index < end; ++index)
+        {
+            meta__repeat_frame(&frames[depth], &var, index);
+            if (!meta__render_segments(tmpl, sink, table, i + 1, segment->end, frames, depth + 1))
+            {
+                return 0;
+            }
+        }
+        i = segment->end;
+    }
+    return 1;
+}
+
+static int meta__template_render_table(
+        MetaTemplate* tmpl,
+        MetaSink* sink,
+        BindingTable* table)
+{
+    assert(tmpl);
+
+    RepeatFrame frames[META_MAX_REPEAT_DEPTH];
+    meta__render_header(sink, tmpl->path);
+    int ok = meta__render_segments(tmpl, sink, table, 0, tmpl->num_segments, frames, 0);
+    meta_sink_write(sink, "\n", 1);
+    return ok;
+}
+
+int meta_template_render_sink(
+        MetaTemplate* tmpl,
+        MetaSink* sink,
+        const MetaBinding* bindings,
+        const int num_bindings)
+{
+    BindingTable table = { 0 };
+    meta__binding_table_load(&table, bindings, num_bindings);
+    int ok = meta__template_render_table(tmpl, sink, &table);
+    meta__binding_table_free(&table);
+    return ok;
+}
+
+int meta_template_render_batch(
+        MetaTemplate* tmpl,
+        MetaSink* sink,
+        const MetaBindingSet* sets,
+        const int num_sets)
+{
+    int ok = 1;
+    BindingTable table = { 0 };
+    for (int i = 0; i < num_sets; ++i)
+    {
+        meta__binding_table_load(&table, sets[i].bindings, sets[i].num_bindings);
+        ok &= meta__template_render_table(tmpl, sink, &table);
+    }
+    meta__binding_table_free(&table);
+    return ok;
+}
+
+int meta_template_render_bindings(
+        MetaTemplate* tmpl,
+        const char* result_path,
+        const MetaBinding* bindings,
+        const int num_bindings)
+{
+    MetaSink sink;
+    if (!meta_sink_file(&sink, result_path))
+    {
+        return 0;
+    }
+    int ok = meta_template_render_sink(tmpl, &sink, bindings, num_bindings);
+    meta_sink_close(&sink);
+    return ok;
+}
+
+int meta_template_render(
+        MetaTemplate* tmpl,
+        const char* result_path,
+        const int num_bindings,
+        ...)
+{
+    va_list ap;
+    va_start(ap, num_bindings);
+    MetaBinding* bindings = meta__bindings_from_va(num_bindings, ap);
+    va_end(ap);
+
+    int ok = meta_template_render_bindings(tmpl, result_path, bindings, num_bindings);
+    free(bindings);
+    return ok;
+}
+
+void meta_template_free(MetaTemplate* tmpl)
+{
+    if (tmpl)
+    {
+        free(tmpl->segments);
+        meta_unmap_file(&tmpl->mapped);
+        free(tmpl->path);
+        free(tmpl);
+    }
+}
+
+// Streaming counterpart of meta__render_segments over source[begin, end). A
+// repeat body is found by lexing ahead to its $<@end>, then lexed again for
+// each index, so only the nesting depth is kept in memory.
+static int meta__stream_range(
+        const char* tmpl_path,
+        const char* source,
+        size_t begin,
+        size_t end,
+        MetaSink* sink,
+        BindingTable* table,
+        RepeatFrame* frames,
+        int depth)
+{
+    size_t pos = begin;
+    MetaSegment segment;
+    while (meta__lex_next(source, end, &pos, &segment))
+    {
+        int kind = segment.kind == META_SEGMENT_SLOT
+                ? meta__directive_kind(source + segment.offset, segment.len)
+                : META_SEGMENT_LITERAL;
+        if (kind == META_SEGMENT_LITERAL || kind == META_SEGMENT_SLOT)
+        {
+            meta__render_segment(sink, source, &segment, table, frames, depth);
+            continue;
+        }
+        if (kind != META_SEGMENT_REPEAT)
+        {
+            fprintf(stderr, "%s: %s $<%.*s>\n", tmpl_path,
+                    kind == META_SEGMENT_END ? "unmatched" : "unknown directive",
+                    (int)segment.len, source + segment.offset);
+            return 0;
+        }
+        if (depth == META_MAX_REPEAT_DEPTH)
+        {
+            fprintf(stderr, "%s: repeats nested deeper than %d\n", tmpl_path, META_MAX_REPEAT_DEPTH);
+            return 0;
+        }
+
+        MetaSegment repeat = segment;
+        size_t body_begin = pos;
+        size_t body_end = pos;
+        int nesting = 1;
+        while (nesting)
+        {
+            body_end = pos;
+            if (!meta__lex_next(source, end, &pos, &segment))
+            {
+                fprintf(stderr, "%s: $<@repeat> without $<@end>\n", tmpl_path);
+                return 0;
+            }
+            if (segment.kind == META_SEGMENT_SLOT)
+            {
+                int inner = meta__directive_kind(source + segment.offset, segment.len);
+                nesting += (inner == META_SEGMENT_REPEAT) - (inner == META_SEGMENT_END);
+            }
+        }
+
+        TemplateToken var;
+        long first, last;
+        if (!meta__repeat_range(source + repeat.offset, repeat.len, table, frames, depth, &var, &first, &last))
+        {
+            return 0;
+        }
+        for (long index = first; index < last; ++index)
+        {
+            meta__repeat_frame(&frames[depth], &var, index);
+            if (!meta__stream_range(tmpl_path, source, body_begin, body_end, sink, table, frames, depth + 1))
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int meta_expand_sink(
+        MetaSink* sink,
+        const char* tmpl_path,
+        const MetaBinding* bindings,
+        const int num_bindings)
+{
+    BindingTable table = { 0 };
+    meta__binding_table_load(&table, bindings, num_bindings);
+    meta__stats.templates += 1;
+
+    double start = meta__now();
+    MetaTemplate* embedded = meta__find_embedded(tmpl_path);
+    if (embedded)
+    {
+        int ok = meta__template_render_table(embedded, sink, &table);
+        meta__binding_table_free(&table);
+        meta__stats.emit_seconds += meta__now() - start;
+        return ok;
+    }
+
+    MetaMappedFile mapped;
+    if (!meta_map_file(tmpl_path, &mapped))
+    {
+        fprintf(stderr, "Could not open template %s\n", tmpl_path);
+        meta__binding_table_free(&table);
+        return 0;
+    }
+    double read_end = meta__now();
+
+    // Segments are rendered as soon as they are lexed; nothing is kept, so
+    // lexing counts as emitting here.
+    RepeatFrame frames[META_MAX_REPEAT_DEPTH];
+    meta__render_header(sink, tmpl_path);
+    int ok = meta__stream_range(tmpl_path, mapped.data, 0, mapped.size, sink, &table, frames, 0);
+    meta_sink_write(sink, "\n", 1);
+    meta__stats.read_seconds += read_end - start;
+    meta__stats.emit_seconds += meta__now() - read_end;
+    meta__stats.bytes_read += mapped.size;
+
+    meta__binding_table_free(&table);
+    meta_unmap_file(&mapped);
+    return ok;
+}
+
+int meta_expand_bindings(
+        const char* result_path,
+        const char* tmpl_path,
+        const MetaBinding* bindings,
+        const int num_bindings)
+{
+    MetaSink sink;
+    if (!meta_sink_file(&sink, result_path))
+    {
+        return 0;
+    }
+    int ok = meta_expand_sink(&sink, tmpl_path, bindings, num_bindings);
+    meta_sink_close(&sink);
+    return ok;
+}
+
+int meta_expand(
+        const char* result_path,
+        const char* tmpl_path,
+        const int num_bindings,
+        ...)
+{
+    va_list ap;
+    va_start(ap, num_bindings);
+    MetaBinding* bindings = meta__bindings_from_va(num_bindings, ap);
+    va_end(ap);
+
+    int ok = meta_expand_bindings(result_path, tmpl_path, bindings, num_bindings);
+    free(bindings);
+    return ok;
+}
+
+// sb_free expands to a block, which can't be used in its ?: expression.
+static void meta__sb_free(void* a)
+{
+    if (a)
+    {
+        free(sgl__sbraw(a));
+    }
+}
+
+// ==== Generated files
+
+int meta_write_if_changed(const char* path, const char* data, size_t size)
+{
+    MetaMappedFile existing;
+    if (meta_map_file(path, &existing))
+    {
+        // An empty file may map to NULL, which memcmp mustn't get.
+        int same = existing.size == size && (size == 0 || !memcmp(existing.data, data, size));
+        meta_unmap_file(&existing);
+        if (same)
+        {
+            return 0;
+        }
+    }
+
+    size_t path_len = strlen(path);
+    char* tmp_path = (char*)malloc(path_len + 5);
+    assert(tmp_path);
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, ".tmp", 5);
+
+    int result = 1;
+    FILE* fd = fopen(tmp_path, "wb");
+    if (!fd)
+    {
+        fprintf(stderr, "Could not open file %s for writing.\n", tmp_path);
+        result = -1;
+    }
+    else
+    {
+        size_t written = fwrite(data, sizeof(char), size, fd);
+        if (fclose(fd) != 0 || written != size)
+        {
+            result = -1;
+        }
+    }
+#if defined(_WIN32)
+    if (result == 1 && !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+#else
+    if (result == 1 && rename(tmp_path, path) != 0)
+#endif
+    {
+        result = -1;
+    }
+    if (result == -1)
+    {
+        fprintf(stderr, "Could not write %s\n", path);
+        remove(tmp_path);
+    }
+    free(tmp_path);
+    return result;
+}
+
+static void meta__depfile_write_path(MetaSink* sink, const char* path)
+{
+    for (const char* c = path; *c; ++c)
+    {
+        if (*c == ' ' || *c == '#')
+        {
+            meta_sink_write(sink, "\\", 1);
+        }
+        else if (*c == '$')
+        {
+            meta_sink_write(sink, "$", 1);
+        }
+        meta_sink_write(sink, c, 1);
+    }
+}
+
+int meta_write_depfile(const char* depfile_path, const char* target, char** deps, int num_deps)
+{
+    // Rendered in memory so that the depfile also keeps its timestamp when
+    // nothing changed.
+    MetaSink sink;
+    meta_sink_memory(&sink);
+
+    meta__depfile_write_path(&sink, target);
+    meta_sink_write(&sink, ":", 1);
+    for (int i = 0; i < num_deps; ++i)
+    {
+        meta_sink_write(&sink, " \\\n  ", 5);
+        meta__depfile_write_path(&sink, deps[i]);
+    }
+    meta_sink_write(&sink, "\n", 1);
+    for (int i = 0; i < num_deps; ++i)
+    {
+        meta_sink_write(&sink, "\n", 1);
+        meta__depfile_write_path(&sink, deps[i]);
+        meta_sink_write(&sink, ":\n", 2);
+    }
+
+    int result = meta_write_if_changed(depfile_path, sink.data, sink.count);
+    meta_sink_close(&sink);
+    return result >= 0;
+}
+
+void meta_gen_begin(MetaGenFile* gen, const char* result_path)
+{
+    gen->path = result_path;
+    gen->deps = NULL;
+    meta_sink_memory(&gen->sink);
+    meta_sink_write(&gen->sink, meta__clear_message, sizeof(meta__clear_message) - 1);
+}
+
+static void meta__gen_add_dep(MetaGenFile* gen, const char* tmpl_path)
+{
+    for (int i = 0; i < sb_count(gen->deps); ++i)
+    {
+        if (!strcmp(gen->deps[i], tmpl_path))
+        {
+            return;
+        }
+    }
+    size_t len = strlen(tmpl_path);
+    char* dep = (char*)malloc(len + 1);
+    assert(dep);
+    memcpy(dep, tmpl_path, len + 1);
+    sb_push(gen->deps, dep);
+}
+
+int meta_gen_expand(
+        MetaGenFile* gen,
+        const char* tmpl_path,
+        const MetaBinding* bindings,
+        const int num_bindings)
+{
+    meta__gen_add_dep(gen, tmpl_path);
+    return meta_expand_sink(&gen->sink, tmpl_path, bindings, num_bindings);
+}
+
+int meta_gen_render(
+        MetaGenFile* gen,
+        MetaTemplate* tmpl,
+        const MetaBinding* bindings,
+        const int num_bindings)
+{
+    meta__gen_add_dep(gen, tmpl->path);
+    return meta_template_render_sink(tmpl, &gen->sink, bindings, num_bindings);
+}
+
+int meta_gen_end(MetaGenFile* gen, const char* depfile_path)
+{
+    int result = meta_write_if_changed(gen->path, gen->sink.data, gen->sink.count);
+    if (result >= 0 && depfile_path)
+    {
+        if (!meta_write_depfile(depfile_path, gen->path, gen->deps, sb_count(gen->deps)))
+        {
+            fprintf(stderr, "Could not write depfile %s\n", depfile_path);
+        }
+    }
+    meta_gen_discard(gen);
+    return result;
+}
+
+void meta_gen_discard(MetaGenFile* gen)
+{
+    meta_sink_close(&gen->sink);
+    for (int i = 0; i < sb_count(gen->deps); ++i)
+    {
+        free(gen->deps[i]);
+    }
+    meta__sb_free(gen->deps);
+    gen->deps = NULL;
+}
+
+// ==== Job lists
+
+enum
+{
+    META_JOB_CLEAR,
+    META_JOB_EXPAND,
+};
+
+typedef struct
+{
+    int                 type;
+    int                 template_index;
+    MetaBinding*        bindings;  // Copy of the caller's array.
+    int                 num_bindings;
+} MetaJob;
+
+// All the jobs for one result file, in queue order.
+typedef struct
+{
+    const char*     result_path;
+    int*            jobs;  // sb_ array of indices into MetaJobList::jobs
+} MetaJobGroup;
+
+struct MetaJobList_s
+{
+    MetaJob*        jobs;       // sb_
+    MetaJobGroup*   groups;     // sb_
+    const char**    templates;  // sb_ paths, compiled when the list runs
+    MetaStrMap      group_index;
+    MetaStrMap      template_index;
+
+    int             write_depfiles;
+
+    // Used while running
+    MetaTemplate**  compiled;
+    const int*      selected;   // Groups to run, or NULL for all of them
+    int             num_selected;
+    SglMutex*       mutex;
+    int             next_group;
+    int             num_failed;
+};
+
+MetaJobList* meta_jobs_create()
+{
+    MetaJobList* jobs = (MetaJobList*)calloc(1, sizeof(MetaJobList));
+    assert(jobs);
+    meta_strmap_init(&jobs->group_index, 64);
+    meta_strmap_init(&jobs->template_index, 64);
+    return jobs;
+}
+
+// Indices are stored in the map's value pointer, off by one so that 0 is "none".
+static int meta__jobs_intern(MetaStrMap* map, const char* key, int next_index)
+{
+    size_t len = strlen(key);
+    MetaStrMapEntry* entry = meta_strmap_insert(map, key, len, meta_hash(key, len),
+                                                (void*)(intptr_t)(next_index + 1));
+    return (int)(intptr_t)entry->value - 1;
+}
+
+static void meta__jobs_push(MetaJobList* jobs, const char* result_path, MetaJob job)
+{
+    int group = meta__jobs_intern(&jobs->group_index, result_path, sb_count(jobs->groups));
+    if (group == sb_count(jobs->groups))
+    {
+        MetaJobGroup new_group = { result_path, NULL };
+        sb_push(jobs->groups, new_group);
+    }
+    sb_push(jobs->groups[group].jobs, sb_count(jobs->jobs));
+    sb_push(jobs->jobs, job);
+}
+
+void meta_jobs_clear(MetaJobList* jobs, const char* result_path)
+{
+    MetaJob job = { META_JOB_CLEAR, -1, NULL, 0 };
+    meta__jobs_push(jobs, result_path, job);
+}
+
+void meta_jobs_expand(
+        MetaJobList* jobs,
+        const char* result_path,
+        const char* tmpl_path,
+        const MetaBinding* bindings,
+        const int num_bindings)
+{
+    MetaJob job = { META_JOB_EXPAND, 0, NULL, num_bindings };
+    job.template_index = meta__jobs_intern(&jobs->template_index, tmpl_path, sb_count(jobs->templates));
+    if (job.template_index == sb_count(jobs->templates))
+    {
+        sb_push(jobs->templates, tmpl_path);
+    }
+    job.bindings = (MetaBinding*)malloc((num_bindings + 1) * sizeof(MetaBinding));
+    assert(job.bindings);
+    memcpy(job.bindings, bindings, num_bindings * sizeof(MetaBinding));
+    meta__jobs_push(jobs, result_path, job);
+}
+
+// Files that start with a clear are known in full, so they are rendered in
+// memory and only written if they changed. If one of the templates didn't
+// compile or render, the file would be missing part of its contents, so the
+// file and its depfile are left as they are. Returns 0 if the group failed.
+static int meta__jobs_run_gen_group(MetaJobList* jobs, MetaJobGroup* group)
+{
+    for (int i = 1; i < sb_count(group->jobs); ++i)
+    {
+        MetaJob* job = &jobs->jobs[group->jobs[i]];
+        if (job->type == META_JOB_EXPAND && !jobs->compiled[job->template_index])
+        {
+            fprintf(stderr, "ERROR: not writing %s, template %s didn't compile.\n",
+                    group->result_path, jobs->templates[job->template_index]);
+            return 0;
+        }
+    }
+
+    MetaGenFile gen;
+    meta_gen_begin(&gen, group->result_path);
+    int ok = 1;
+    BindingTable table = { 0 };
+    for (int i = 1; i < sb_count(group->jobs) && ok; ++i)
+    {
+        MetaJob* job = &jobs->jobs[group->jobs[i]];
+        if (job->type == META_JOB_CLEAR)
+        {
+            gen.sink.count = 0;
+            meta_sink_write(&gen.sink, meta__clear_message, sizeof(meta__clear_message) - 1);
+        }
+        else
+        {
+            MetaTemplate* tmpl = jobs->compiled[job->template_index];
+            meta__gen_add_dep(&gen, tmpl->path);
+            meta__binding_table_load(&table, job->bindings, job->num_bindings);
+            ok = meta__template_render_table(tmpl, &gen.sink, &table);
+        }
+    }
+    meta__binding_table_free(&table);
+    if (!ok)
+    {
+        fprintf(stderr, "ERROR: not writing %s, a template failed to render.\n", group->result_path);
+        meta_gen_discard(&gen);
+        return 0;
+    }
+
+    size_t path_len = strlen(group->result_path);
+    char* depfile_path = (char*)malloc(path_len + 3);
+    assert(depfile_path);
+    memcpy(depfile_path, group->result_path, path_len);
+    memcpy(depfile_path + path_len, ".d", 3);
+    int result = meta_gen_end(&gen, depfile_path);
+    free(depfile_path);
+    return result >= 0;
+}
+
+// Returns 0 if the group failed.
+static int meta__jobs_run_group(MetaJobList* jobs, MetaJobGroup* group)
+{
+    if (jobs->write_depfiles && jobs->jobs[group->jobs[0]].type == META_JOB_CLEAR)
+    {
+        return meta__jobs_run_gen_group(jobs, group);
+    }
+
+    int ok = 1;
+    MetaSink sink = { 0 };
+    int sink_open = 0;
+    BindingTable table = { 0 };
+    for (int i = 0; i < sb_count(group->jobs); ++i)
+    {
+        MetaJob* job = &jobs->jobs[group->jobs[i]];
+        if (job->type == META_JOB_CLEAR)
+        {
+            if (sink_open)
+            {
+                meta_sink_close(&sink);
+                sink_open = 0;
+            }
+            meta_clear_file(group->result_path);
+        }
+        else
+        {
+            MetaTemplate* tmpl = jobs->compiled[job->template_index];
+            if (!tmpl)
+            {
+                fprintf(stderr, "ERROR: skipping template %s for %s, it didn't compile.\n",
+                        jobs->templates[job->template_index], group->result_path);
+                ok = 0;
+                continue;
+            }
+            if (!sink_open)
+            {
+                sink_open = meta_sink_file(&sink, group->result_path);
+                if (!sink_open)
+                {
+                    ok = 0;
+                    break;
+                }
+            }
+            meta__binding_table_load(&table, job->bindings, job->num_bindings);
+            if (!meta__template_render_table(tmpl, &sink, &table))
+            {
+                ok = 0;
+            }
+        }
+    }
+    if (sink_open)
+    {
+        meta_sink_close(&sink);
+    }
+    meta__binding_table_free(&table);
+    return ok;
+}
+
+static void meta__jobs_worker(void* params)
+{
+    MetaJobList* jobs = (MetaJobList*)params;
+    for (;;)
+    {
+        sgl_mutex_lock(jobs->mutex);
+        int next = jobs->next_group++;
+        sgl_mutex_unlock(jobs->mutex);
+
+        if (next >= jobs->num_selected)
+        {
+            break;
+        }
+        int group = jobs->selected ? jobs->selected[next] : next;
+        if (!meta__jobs_run_group(jobs, &jobs->groups[group]))
+        {
+            sgl_mutex_lock(jobs->mutex);
+            ++jobs->num_failed;
+            sgl_mutex_unlock(jobs->mutex);
+        }
+    }
+}
+
+void meta_jobs_write_depfiles(MetaJobList* jobs, int enabled)
+{
+    jobs->write_depfiles = enabled;
+}
+
+static void meta__jobs_compile(MetaJobList* jobs)
+{
+    int num_templates = sb_count(jobs->templates);
+    jobs->compiled = (MetaTemplate**)calloc(num_templates + 1, sizeof(MetaTemplate*));
+    assert(jobs->compiled);
+    for (int i = 0; i < num_templates; ++i)
+    {
+        jobs->compiled[i] = meta_template_compile(jobs->templates[i]);
+    }
+}
+
+static void meta__jobs_release(MetaJobList* jobs)
+{
+    for (int i = 0; i < sb_count(jobs->templates); ++i)
+    {
+        meta_template_free(jobs->compiled[i]);
+    }
+    free(jobs->compiled);
+    jobs->compiled = NULL;
+}
+
+// Runs the given groups, or all of them if `selected` is NULL. Templates must
+// be compiled. Returns the number of groups that failed.
+static int meta__jobs_run_groups(MetaJobList* jobs, int num_threads, const int* selected, int num_selected)
+{
+    jobs->selected = selected;
+    jobs->num_selected = selected ? num_selected : sb_count(jobs->groups);
+
+    if (num_threads <= 0)
+    {
+        num_threads = sgl_cpu_count();
+    }
+    if (num_threads > jobs->num_selected)
+    {
+        num_threads = jobs->num_selected;
+    }
+
+    jobs->next_group = 0;
+    jobs->num_failed = 0;
+    jobs->mutex = sgl_create_mutex();
+    assert(jobs->mutex);
+    sgl_run_workers(num_threads, meta__jobs_worker, jobs);
+    sgl_destroy_mutex(jobs->mutex);
+    jobs->mutex = NULL;
+    jobs->selected = NULL;
+    return jobs->num_failed;
+}
+
+int meta_jobs_run(MetaJobList* jobs, int num_threads)
+{
+    meta__jobs_compile(jobs);
+    int num_failed = meta__jobs_run_groups(jobs, num_threads, NULL, 0);
+    meta__jobs_release(jobs);
+    return num_failed;
+}
+
+void meta_jobs_free(MetaJobList* jobs)
+{
+    if (jobs)
+    {
+        for (int i = 0; i < sb_count(jobs->jobs); ++i)
+        {
+            free(jobs->jobs[i].bindings);
+        }
+        for (int i = 0; i < sb_count(jobs->groups); ++i)
+        {
+            meta__sb_free(jobs->groups[i].jobs);
+        }
+        meta__sb_free(jobs->jobs);
+        meta__sb_free(jobs->groups);
+        meta__sb_free(jobs->templates);
+        meta_strmap_free(&jobs->group_index);
+        meta_strmap_free(&jobs->template_index);
+        free(jobs);
+    }
+}
+
+// ==== C tokens
+
+enum
+{
+    META_CHAR_SPACE = 1 << 0,   // ' ' \t \v \f \r, but not \n
+    META_CHAR_IDENT = 1 << 1,   // a-z A-Z _
+    META_CHAR_DIGIT = 1 << 2,   // 0-9
+};
+
+#define S_ META_CHAR_SPACE
+#define I_ META_CHAR_IDENT
+#define D_ META_CHAR_DIGIT
+static const uint8_t meta__char_class[256] =
+{
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  S_, 0,  S_, S_, S_, 0,  0,
+    0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    S_, 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    D_, D_, D_, D_, D_, D_, D_, D_, D_, D_, 0,  0,  0,  0,  0,  0,
+    0,  I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_,
+    I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, 0,  0,  0,  0,  I_,
+    0,  I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_,
+    I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, I_, 0,  0,  0,  0,  0,
+    // Everything above 0x7f is 0
+};
+#undef S_
+#undef I_
+#undef D_
+
+static int meta__is_digit(char c)
+{
+    return meta__char_class[(uint8_t)c] & META_CHAR_DIGIT;
+}
+
+// First index >= i whose class isn't in `classes`.
+static size_t meta__skip_class_scalar(const char* src, size_t i, size_t len, int classes)
+{
+    while (i < len && (meta__char_class[(uint8_t)src[i]] & classes))
+    {
+        ++i;
+    }
+    return i;
+}
+
+#if defined(META_SSE2) && !defined(META_SCALAR_LEXER)
+// (uint8_t)(v - lo) < count, with signed compares: shift the range down to -128.
+static __m128i meta__in_range16(__m128i v, char lo, int count)
+{
+    __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8((char)(lo + 128)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(count - 128)));
+}
+
+// Bit i is set if byte i is in `classes`. Only META_CHAR_SPACE and
+// META_CHAR_IDENT | META_CHAR_DIGIT are supported.
+static uint32_t meta__class_mask16(const char* p, int classes)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*)p);
+    __m128i in;
+    if (classes == META_CHAR_SPACE)
+    {
+        in = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                          _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                                       meta__in_range16(v, '\v', 3)));  // \v \f \r
+    }
+    else
+    {
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        in = _mm_or_si128(_mm_or_si128(meta__in_range16(lower, 'a', 26),
+                                       meta__in_range16(v, '0', 10)),
+                          _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    }
+    return (uint32_t)_mm_movemask_epi8(in);
+}
+#endif
+
+// Same as meta__skip_class_scalar. Runs of whitespace and identifier
+// characters are most of a C file; most are short, so the table is tried
+// first and runs longer than that go 16 bytes at a time.
+static size_t meta__skip_class(const char* src, size_t i, size_t len, int classes)
+{
+#if defined(META_SSE2) && !defined(META_SCALAR_LEXER)
+    size_t scalar_end = len - i > 8 ? i + 8 : len;
+    while (i < scalar_end && (meta__char_class[(uint8_t)src[i]] & classes))
+    {
+        ++i;
+    }
+    if (i < scalar_end)
+    {
+        return i;
+    }
+    while (len - i >= 16)
+    {
+        uint32_t outside = ~meta__class_mask16(src + i, classes) & 0xffff;
+        if (outside)
+        {
+            return i + meta__ctz(outside);
+        }
+        i += 16;
+    }
+#endif
+    return meta__skip_class_scalar(src, i, len, classes);
+}
+
+// Appends the tokens of src to the sb_ array `tokens`.
+static MetaToken* meta__lex_c(const char* src, size_t len, MetaToken* tokens)
+{
+    const char* end = src + len;
+    int line_start = 1;  // Only whitespace since the last newline
+    size_t i = 0;
+    while (i < len)
+    {
+        char c = src[i];
+        int char_class = meta__char_class[(uint8_t)c];
+        if (char_class & META_CHAR_SPACE)
+        {
+            i = meta__skip_class(src, i + 1, len, META_CHAR_SPACE);
+            continue;
+        }
+        if (c == '\n')
+        {
+            line_start = 1;
+            ++i;
+            continue;
+        }
+        if (c == '/' && i + 1 < len && src[i + 1] == '/')
+        {
+            const char* newline = meta__find_byte(src + i + 2, end, '\n');
+            i = newline ? (size_t)(newline - src) : len;
+            continue;
+        }
+        if (c == '/' && i + 1 < len && src[i + 1] == '*')
+        {
+            const char* p = src + i + 2;
+            for (;;)
+            {
+                const char* star = meta__find_byte(p, end, '*');
+                if (!star || star + 1 >= end)
+                {
+                    p = end;
+                    break;
+                }
+                if (star[1] == '/')
+                {
+                    p = star + 2;
+                    break;
+                }
+                p = star + 1;
+            }
+            i = (size_t)(p - src);
+            continue;
+        }
+
+        MetaToken token = { META_TOKEN_PUNCT, (uint32_t)i, 1 };
+        if (c == '#' && line_start)
+        {
+            token.kind = META_TOKEN_DIRECTIVE;
+            for (;;)
+            {
+                const char* newline = meta__find_byte(src + i, end, '\n');
+                if (!newline)
+                {
+                    i = len;
+                    break;
+                }
+                i = (size_t)(newline - src);
+                if (src[i - 1] != '\\')
+                {
+                    break;
+                }
+                ++i;
+            }
+        }
+        else if (char_class & META_CHAR_IDENT)
+        {
+            token.kind = META_TOKEN_IDENT;
+            i = meta__skip_class(src, i + 1, len, META_CHAR_IDENT | META_CHAR_DIGIT);
+        }
+        else if ((char_class & META_CHAR_DIGIT) || (c == '.' && i + 1 < len && meta__is_digit(src[i + 1])))
+        {
+            token.kind = META_TOKEN_NUMBER;
+            ++i;
+            while (i < len)
+            {
+                char n = src[i];
+                char prev = src[i - 1];
+                if ((meta__char_class[(uint8_t)n] & (META_CHAR_IDENT | META_CHAR_DIGIT)) || n == '.' ||
+                    ((n == '+' || n == '-') &&
+                     (prev == 'e' || prev == 'E' || prev == 'p' || prev == 'P')))
+                {
+                    ++i;
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+        else if (c == '"' || c == '\'')
+        {
+            token.kind = c == '"' ? META_TOKEN_STRING : META_TOKEN_CHAR;
+            ++i;
+            while (i < len && src[i] != c && src[i] != '\n')
+            {
+                i += (src[i] == '\\') ? 2 : 1;
+            }
+            if (i < len && src[i] == c)
+            {
+                ++i;
+            }
+        }
+        else
+        {
+            ++i;
+        }
+        if (i > len)
+        {
+            i = len;
+        }
+        token.len = (uint32_t)(i - token.offset);
+        line_start = 0;
+        sb_push(tokens, token);
+    }
+    return tokens;
+}
+
+MetaToken* meta_lex_c(const char* src, size_t len)
+{
+    return meta__lex_c(src, len, NULL);
+}
+
+void meta_free_tokens(MetaToken* tokens)
+{
+    meta__sb_free(tokens);
+}
+
+static int meta__token_is(const char* src, const MetaToken* token, const char* str)
+{
+    size_t len = strlen(str);
+    return token->len == len && !memcmp(src + token->offset, str, len);
+}
+
+static int meta__token_is_punct(const char* src, const MetaToken* token, char c)
+{
+    return token->kind == META_TOKEN_PUNCT && src[token->offset] == c;
+}
+
+static char* meta__strndup(const char* str, size_t len)
+{
+    char* copy = (char*)malloc(len + 1);
+    assert(copy);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+// Index of the token that closes the brace/bracket/paren at `open`, or num_tokens.
+static int meta__matching_token(const char* src, const MetaToken* tokens, int num_tokens, int open)
+{
+    char open_c = src[tokens[open].offset];
+    char close_c = open_c == '{' ? '}' : open_c == '[' ? ']' : ')';
+    int depth = 0;
+    for (int i = open; i < num_tokens; ++i)
+    {
+        if (meta__token_is_punct(src, &tokens[i], open_c))
+        {
+            ++depth;
+        }
+        else if (meta__token_is_punct(src, &tokens[i], close_c) && --depth == 0)
+        {
+            return i;
+        }
+    }
+    return num_tokens;
+}
+
+// Note:
+//  Parser should output defines of the form
+//  #define ADCTYPE_FILE_filename_SCOPE_scope_NAME_name
+//  `scope` can be 'global' or the name of a top level function/struct/enum
+//      e.g. my_file.c has a global int variable named foo
+//      therefore we have:
+//      #define ADCTYPE_FILE_my_file_SCOPE_global_NAME_foo int
+
+
+// Type info for one source file. Files are parsed independently, and the
+// output is produced from all of them, so a changed file is re-parsed alone.
+typedef struct
+{
+    char*   path;
+    const char* name;   // File name part of `path`
+    int     dir_id;     // Set by the directory callback when scanning
+    char**  types;      // sb_ array. Type names declared here: typedefs and struct names.
+    // sb_ array of declarations, each one: variable name, type tokens from
+    // last to first, enclosing function ("global" at file scope), NULL
+    char**  decls;
+    char**  includes;   // sb_ array. Names in #include "name", as written.
+    void*   memory;     // The strings `types`, `decls` and `includes` point to
+    size_t  memory_size;
+
+    // What was parsed, to tell if the file changed since.
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t content_hash;
+} TypeInfoFile;
+
+// Memory for parsing one file at a time, reused from file to file so that it
+// grows to the largest file instead of adding up. Each worker has its own.
+typedef struct
+{
+    MetaToken*  tokens;     // sb_
+    char**      tokenstack; // sb_. Names, ";" and "*" since the file start.
+    void*       memory;     // Names of the file being parsed
+    Arena       names;
+    MetaStats   stats;      // Added to meta__stats when the files are done
+} TypeInfoScratch;
+
+static void meta__type_info_scratch_free(TypeInfoScratch* scratch)
+{
+    meta__sb_free(scratch->tokens);
+    meta__sb_free(scratch->tokenstack);
+    free(scratch->memory);
+    memset(scratch, 0, sizeof(TypeInfoScratch));
+}
+
+
+enum
+{
+    PARSE_TOP         = (1 << 0),
+    PARSE_GOT_STRUCT  = (1 << 1),
+    PARSE_IN_STRUCT   = (1 << 2),
+    PARSE_GOT_TYPEDEF = (1 << 3),
+    PARSE_GOT_ENUM    = (1 << 4),
+    PARSE_IN_FUNC     = (1 << 5),
+};
+
+// Identifiers and numbers joined by '.' or ':' with nothing in between, like
+// `bar.x` or `std::vector`, are parsed as one name. Returns the index of the
+// name's last token.
+static int meta__type_info_name_end(const char* src, const MetaToken* tokens, int num_tokens, int i)
+{
+    for (;;)
+    {
+        int j = i + 1;
+        uint32_t end = tokens[i].offset + tokens[i].len;
+        while (j < num_tokens && tokens[j].kind == META_TOKEN_PUNCT && tokens[j].offset == end &&
+               (src[end] == '.' || src[end] == ':'))
+        {
+            ++j;
+            ++end;
+        }
+        if (j == i + 1 || j == num_tokens || tokens[j].offset != end ||
+            (tokens[j].kind != META_TOKEN_IDENT && tokens[j].kind != META_TOKEN_NUMBER))
+        {
+            return i;
+        }
+        i = j;
+    }
+}
+
+// What the type info parser and output know about a name.
+enum
+{
+    SYMBOL_TYPE      = (1 << 0),  // Valid in a type declaration
+    SYMBOL_QUALIFIER = (1 << 1),  // Left out of the output
+    SYMBOL_CONTROL   = (1 << 2),  // Control flow, never part of a declaration
+    SYMBOL_STRUCT    = (1 << 3),
+    SYMBOL_TYPEDEF   = (1 << 4),
+    SYMBOL_ENUM      = (1 << 5),
+};
+
+typedef struct
+{
+    const char* name;
+    int         flags;
+} TypeInfoSymbol;
+
+static const TypeInfoSymbol meta__type_info_keywords[] =
+{
+    { "static",   SYMBOL_TYPE | SYMBOL_QUALIFIER },
+    { "const",    SYMBOL_TYPE | SYMBOL_QUALIFIER },
+    { "volatile", SYMBOL_QUALIFIER },
+    { "auto",     SYMBOL_QUALIFIER },
+    { "unsigned", SYMBOL_TYPE },
+    { "char",     SYMBOL_TYPE },
+    { "short",    SYMBOL_TYPE },
+    { "int",      SYMBOL_TYPE },
+    { "long",     SYMBOL_TYPE },
+    { "float",    SYMBOL_TYPE },
+    { "double",   SYMBOL_TYPE },
+    { "uint8_t",  SYMBOL_TYPE },
+    { "uint16_t", SYMBOL_TYPE },
+    { "uint32_t", SYMBOL_TYPE },
+    { "uint64_t", SYMBOL_TYPE },
+    { "int8_t",   SYMBOL_TYPE },
+    { "int16_t",  SYMBOL_TYPE },
+    { "int32_t",  SYMBOL_TYPE },
+    { "int64_t",  SYMBOL_TYPE },
+    { "struct",   SYMBOL_TYPE | SYMBOL_STRUCT },
+    { "*",        SYMBOL_TYPE },
+    { "typedef",  SYMBOL_TYPEDEF },
+    { "enum",     SYMBOL_ENUM },
+    { "do",       SYMBOL_CONTROL },
+    { "while",    SYMBOL_CONTROL },
+    { "for",      SYMBOL_CONTROL },
+    { "if",       SYMBOL_CONTROL },
+    { "else",     SYMBOL_CONTROL },
+};
+
+// Adds `flags` to the symbol `name`. The table keeps the pointer.
+static void meta__symbols_add(MetaStrMap* symbols, const char* name, size_t len, int flags)
+{
+    MetaStrMapEntry* entry = meta_strmap_insert(symbols, name, len, meta_hash(name, len), NULL);
+    entry->value = (void*)((uintptr_t)entry->value | (uintptr_t)flags);
+}
+
+static int meta__symbols_find(MetaStrMap* symbols, const char* name, size_t len)
+{
+    MetaStrMapEntry* entry = meta_strmap_find(symbols, name, len, meta_hash(name, len));
+    return entry ? (int)(uintptr_t)entry->value : 0;
+}
+
+static void meta__symbols_init(MetaStrMap* symbols, size_t expected_count)
+{
+    size_t num_keywords = sizeof(meta__type_info_keywords) / sizeof(TypeInfoSymbol);
+    meta_strmap_init(symbols, num_keywords + expected_count);
+    for (size_t i = 0; i < num_keywords; ++i)
+    {
+        const TypeInfoSymbol* keyword = &meta__type_info_keywords[i];
+        meta__symbols_add(symbols, keyword->name, strlen(keyword->name), keyword->flags);
+    }
+}
+
+// Keywords only. Read-only once built, the first time type info is scanned.
+static MetaStrMap* meta__type_info_keyword_map()
+{
+    static MetaStrMap keywords;
+    if (!keywords.entries)
+    {
+        meta__symbols_init(&keywords, 0);
+    }
+    return &keywords;
+}
+
+// Moves the strings of the file's results out of the scratch memory, into
+// one block sized to fit them. Repeated names are stored once.
+static void meta__type_info_keep(TypeInfoFile* file)
+{
+    char** lists[3] = { file->types, file->decls, file->includes };
+    MetaStrMap names = { 0 };
+    meta_strmap_init(&names, sb_count(file->types) + sb_count(file->decls) + sb_count(file->includes));
+    size_t size = 0;
+    for (int l = 0; l < 3; ++l)
+    {
+        for (int i = 0; i < sb_count(lists[l]); ++i)
+        {
+            char* name = lists[l][i];
+            if (name)
+            {
+                size_t len = strlen(name);
+                size_t count = names.count;
+                meta_strmap_insert(&names, name, len, meta_hash(name, len), NULL);
+                if (names.count != count)
+                {
+                    size += len + 1;
+                }
+            }
+        }
+    }
+
+    char* memory = (char*)malloc(size + 1);
+    assert(memory);
+    char* next = memory;
+    for (size_t i = 0; i < names.capacity; ++i)
+    {
+        MetaStrMapEntry* entry = &names.entries[i];
+        if (entry->key)
+        {
+            memcpy(next, entry->key, entry->key_len + 1);
+            entry->value = next;
+            next += entry->key_len + 1;
+        }
+    }
+    for (int l = 0; l < 3; ++l)
+    {
+        for (int i = 0; i < sb_count(lists[l]); ++i)
+        {
+            char* name = lists[l][i];
+            if (name)
+            {
+                size_t len = strlen(name);
+                lists[l][i] = (char*)meta_strmap_find(&names, name, len, meta_hash(name, len))->value;
+            }
+        }
+    }
+    meta_strmap_free(&names);
+    file->memory = memory;
+    file->memory_size = size;
+}
+
+// Returns the length of the name in `#include "name"`, which *name points
+// to, or 0 for any other directive. <name> is left to the compiler's paths.
+static size_t meta__directive_include(const char* src, const MetaToken* token, const char** name)
+{
+    const char* c = src + token->offset + 1;
+    const char* end = src + token->offset + token->len;
+    while (c < end && (*c == ' ' || *c == '\t'))
+    {
+        ++c;
+    }
+    if (end - c < 7 || memcmp(c, "include", 7))
+    {
+        return 0;
+    }
+    c += 7;
+    while (c < end && (*c == ' ' || *c == '\t'))
+    {
+        ++c;
+    }
+    if (c == end || *c != '"')
+    {
+        return 0;
+    }
+    const char* close = meta__find_byte(c + 1, end, '"');
+    if (!close || close == c + 1)
+    {
+        return 0;
+    }
+    *name = c + 1;
+    return (size_t)(close - *name);
+}
+
+static void process_file(const char* fname, TypeInfoFile* file, TypeInfoScratch* scratch)
+{
+    MetaMappedFile mapped;
+    double start = meta__now();
+    if (!meta_map_file(fname, &mapped))
+    {
+        fprintf(stderr, "Could not open file for processing, %s\n", fname);
+        return;
+    }
+    const char* src = mapped.data;
+    file->content_hash = meta_hash64(src, mapped.size);
+    double read_end = meta__now();
+    if (scratch->tokens)
+    {
+        sgl__sbcount(scratch->tokens) = 0;
+    }
+    MetaToken* tokens = scratch->tokens = meta__lex_c(src, mapped.size, scratch->tokens);
+    int num_tokens = sb_count(tokens);
+    double lex_end = meta__now();
+
+    // Names are copied with their terminator, and no two names overlap, so
+    // one byte per token on top of the file size is enough.
+    size_t size = mapped.size + (size_t)num_tokens + 1;
+    if (scratch->names.size < size)
+    {
+        free(scratch->memory);
+        scratch->memory = malloc(size);
+        assert(scratch->memory);
+        scratch->names = arena_init(scratch->memory, size);
+    }
+    else
+    {
+        arena_reset(&scratch->names);
+    }
+    Arena* root_arena = &scratch->names;
+
+    MetaStrMap* keywords = meta__type_info_keyword_map();
+
+    int parse_state = PARSE_TOP;
+    char** tokenstack = scratch->tokenstack;
+    if (tokenstack)
+    {
+        sgl__sbcount(tokenstack) = 0;
+    }
+    char* current_func = 0;    // Used for code-gen
+    int brace_count = 0;       // To determine if leaving function scope.
+    for (int t = 0; t < num_tokens; ++t)
+    {
+        const MetaToken* token = &tokens[t];
+        if (token->kind == META_TOKEN_IDENT || token->kind == META_TOKEN_NUMBER)
+        {
+            int last = meta__type_info_name_end(src, tokens, num_tokens, t);
+            size_t len = tokens[last].offset + tokens[last].len - token->offset;
+            int symbol = 0;
+            if (last == t && token->kind == META_TOKEN_IDENT)
+            {
+                symbol = meta__symbols_find(keywords, src + token->offset, len);
+            }
+            if (!(symbol & SYMBOL_CONTROL))
+            {
+                char* name = arena_alloc_array(root_arena, len + 1, char);
+                assert(name);
+                memcpy(name, src + token->offset, len);
+                name[len] = '\0';
+                if (parse_state & PARSE_GOT_STRUCT)
+                {
+                    sb_push(file->types, name);
+                    if (meta__verbose)
+                    {
+                        printf("Typeinfo: added struct name %s\n", name);
+                    }
+                }
+                sb_push(tokenstack, name);
+
+                if (!(parse_state & (PARSE_GOT_STRUCT | PARSE_IN_STRUCT | PARSE_IN_FUNC)) && (symbol & SYMBOL_STRUCT))
+                {
+                    parse_state |= PARSE_GOT_STRUCT;
+                }
+                else if (!(parse_state & PARSE_GOT_TYPEDEF) && (symbol & SYMBOL_TYPEDEF))
+                {
+                    parse_state |= PARSE_GOT_TYPEDEF;
+                }
+                else if (!(parse_state & PARSE_GOT_ENUM) && (symbol & SYMBOL_ENUM))
+                {
+                    parse_state |= PARSE_GOT_ENUM;
+                }
+            }
+            t = last;
+            continue;
+        }
+        if (token->kind == META_TOKEN_DIRECTIVE)
+        {
+            const char* include = NULL;
+            size_t len = meta__directive_include(src, token, &include);
+            if (len)
+            {
+                char* name = arena_alloc_array(root_arena, len + 1, char);
+                assert(name);
+                memcpy(name, include, len);
+                name[len] = '\0';
+                sb_push(file->includes, name);
+            }
+            continue;
+        }
+        if (token->kind != META_TOKEN_PUNCT)
+        {
+            // Strings and characters.
+            continue;
+        }
+
+        char c = src[token->offset];
+        if (c == ';')
+        {
+            ///// check typedef (to append to known types)
+            if ((parse_state & PARSE_GOT_TYPEDEF) && !(parse_state & PARSE_IN_STRUCT))
+            {
+                parse_state &= ~PARSE_GOT_TYPEDEF;
+                if (t > 0 && tokens[t - 1].kind == META_TOKEN_IDENT && sb_count(tokenstack))
+                {
+                    char* type = sb_last(tokenstack);
+                    sb_push(file->types, type);
+                    if (meta__verbose)
+                    {
+                        printf("Typeinfo: added type %s\n", type);
+                    }
+                }
+            }
+            sb_push(tokenstack, ";");
+            parse_state &= ~PARSE_GOT_STRUCT;
+            if (!(parse_state & PARSE_IN_STRUCT))
+            {
+                // `enum Foo x;` has no body.
+                parse_state &= ~PARSE_GOT_ENUM;
+            }
+        }
+        else if (c == '*')
+        {
+            sb_push(tokenstack, "*");
+        }
+        else if (c == '{')
+        {
+            ///// Check struct
+            if (parse_state & PARSE_GOT_STRUCT)
+            {
+                parse_state &= ~PARSE_GOT_STRUCT;
+                parse_state |= PARSE_IN_STRUCT;
+            }
+            //// check for function.
+            if (parse_state == PARSE_TOP && sb_count(tokenstack))
+            {
+                char* funcname = sb_last(tokenstack);
+                if (meta__verbose)
+                {
+                    printf("Got function, named: %s\n", funcname);
+                }
+                current_func = funcname;
+                parse_state |= PARSE_IN_FUNC;
+                sb_push(tokenstack, ";");  // Anchor for doing type chencking
+            }
+            if (parse_state & PARSE_IN_FUNC)
+            {
+                brace_count += 1;
+            }
+        }
+        else if (c == '}')
+        {
+            parse_state &= ~(PARSE_IN_STRUCT | PARSE_GOT_ENUM);
+            if (parse_state & PARSE_IN_FUNC)
+            {
+                brace_count -= 1;
+                if (brace_count == 0)
+                {
+                    if (meta__verbose)
+                    {
+                        printf("Leaving function %s.\n", current_func);
+                    }
+                    current_func = 0;
+                    parse_state &= ~PARSE_IN_FUNC;
+                }
+                else
+                {
+                    sb_push(tokenstack, ";");  // Anchor for doing type chencking
+                }
+            }
+        }
+        else if (c == '=' && !(t > 0 && tokens[t - 1].kind == META_TOKEN_PUNCT &&
+                               src[tokens[t - 1].offset] == '=' &&
+                               tokens[t - 1].offset + 1 == token->offset))
+        {
+            // Assignment: the tokens back to the last anchor are the
+            // variable name and its type, last to first. `==` only counts once.
+            int i = sb_count(tokenstack);
+            int tokens_consumed = 0;
+            while (i && strcmp(tokenstack[i - 1], ";"))
+            {
+                sb_push(file->decls, tokenstack[--i]);
+                ++tokens_consumed;
+            }
+            if (tokens_consumed)
+            {
+                sb_push(file->decls, current_func ? current_func : (char*)"global");
+                sb_push(file->decls, (char*)0);
+            }
+        }
+    }
+
+    scratch->tokenstack = tokenstack;
+    if (root_arena->count > scratch->stats.peak_arena)
+    {
+        scratch->stats.peak_arena = root_arena->count;
+    }
+    scratch->stats.bytes_read += mapped.size;
+    scratch->stats.tokens += (uint64_t)num_tokens;
+    meta_unmap_file(&mapped);
+    meta__type_info_keep(file);
+
+    scratch->stats.read_seconds += read_end - start;
+    scratch->stats.lex_seconds += lex_end - read_end;
+    scratch->stats.parse_seconds += meta__now() - lex_end;
+}
+
+static void meta__type_info_free_file(TypeInfoFile* file)
+{
+    meta__sb_free(file->types);
+    meta__sb_free(file->decls);
+    meta__sb_free(file->includes);
+    free(file->memory);
+    free(file->path);
+    memset(file, 0, sizeof(TypeInfoFile));
+}
+
+static void meta__type_info_parse(TypeInfoFile* file, TypeInfoScratch* scratch)
+{
+    meta__sb_free(file->types);
+    meta__sb_free(file->decls);
+    meta__sb_free(file->includes);
+    free(file->memory);
+    file->types = NULL;
+    file->decls = NULL;
+    file->includes = NULL;
+    file->memory = NULL;
+    file->memory_size = 0;
+
+    if (meta__verbose)
+    {
+        printf("[...] Processing %s\n", file->path);
+    }
+    // Before reading, so that a change made while parsing is seen next time.
+    if (!meta__file_stat(file->path, &file->size, &file->mtime))
+    {
+        file->size = file->mtime = 0;
+    }
+    process_file(file->path, file, scratch);
+}
+
+static const char* meta__type_info_exts[] = {"cc", "cpp", "c", "h", "hh", "hpp"};
+
+static int meta__type_info_accepted(const char* name)
+{
+    const char* ext = strrchr(name, '.');
+    if (!ext)
+    {
+        return 0;
+    }
+    for (int i = 0; i < (int)(sizeof(meta__type_info_exts) / sizeof(char*)); ++i)
+    {
+        if (!strcmp(ext + 1, meta__type_info_exts[i]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Called for every directory scanned. Returns the dir_id of its files.
+typedef int (*TypeInfoDirFunc)(void* user_data, const char* dir_path);
+
+// Returns 1 if the file is the same as when `file` was parsed. Only reads it
+// if the size matches but the time doesn't.
+static int meta__type_info_fresh(TypeInfoFile* file)
+{
+    uint64_t size, mtime;
+    if (!file->memory || !meta__file_stat(file->path, &size, &mtime) || size != file->size)
+    {
+        return 0;
+    }
+    if (mtime == file->mtime)
+    {
+        return 1;
+    }
+    MetaMappedFile mapped;
+    if (!meta_map_file(file->path, &mapped))
+    {
+        return 0;
+    }
+    int same = meta_hash64(mapped.data, mapped.size) == file->content_hash;
+    meta_unmap_file(&mapped);
+    if (same)
+    {
+        file->mtime = mtime;
+    }
+    return same;
+}
+
+// Files are parsed on worker threads. Every file has its own memory block and
+// its own results, so workers only share the index of the next file, and the
+// output doesn't depend on which worker parsed what.
+typedef struct
+{
+    TypeInfoFile*   files;
+    const int*      to_parse;   // Indices into `files`
+    int             num_to_parse;
+    int             next;
+    SglMutex*       mutex;
+} TypeInfoParseJob;
+
+static void meta__type_info_worker(void* data)
+{
+    TypeInfoParseJob* job = (TypeInfoParseJob*)data;
+    TypeInfoScratch scratch = { 0 };
+    for (;;)
+    {
+        sgl_mutex_lock(job->mutex);
+        int next = job->next++;
+        sgl_mutex_unlock(job->mutex);
+
+        if (next >= job->num_to_parse)
+        {
+            break;
+        }
+        meta__type_info_parse(&job->files[job->to_parse[next]], &scratch);
+    }
+    // The calling thread waits for the workers and doesn't touch the stats.
+    sgl_mutex_lock(job->mutex);
+    meta__stats_add(&meta__stats, &scratch.stats);
+    sgl_mutex_unlock(job->mutex);
+    meta__type_info_scratch_free(&scratch);
+}
+
+static void meta__type_info_parse_files(TypeInfoFile* files, const int* to_parse, int num_to_parse)
+{
+    int num_threads = sgl_cpu_count();
+    if (num_threads > num_to_parse)
+    {
+        num_threads = num_to_parse;
+    }
+
+    // Built here so that workers only read it.
+    meta__type_info_keyword_map();
+
+    TypeInfoParseJob job = { files, to_parse, num_to_parse, 0, sgl_create_mutex() };
+    assert(job.mutex);
+    sgl_run_workers(num_threads, meta__type_info_worker, &job);
+    sgl_destroy_mutex(job.mutex);
+}
+
+typedef struct
+{
+    MetaStrMap*     reuse;
+    TypeInfoDirFunc dir_func;
+    void*           user_data;
+    int             dir_id;
+    TypeInfoFile*   files;      // sb_
+    int*            to_parse;   // sb_, indices into files
+} TypeInfoWalk;
+
+static void meta__type_info_walk_func(void* user_data, const char* path, const char* name, int32_t is_dir)
+{
+    TypeInfoWalk* walk = (TypeInfoWalk*)user_data;
+    if (is_dir)
+    {
+        walk->dir_id = walk->dir_func ? walk->dir_func(walk->user_data, path) : 0;
+        return;
+    }
+
+    size_t len = strlen(path);
+    MetaStrMapEntry* entry = meta_strmap_find(walk->reuse, path, len, meta_hash(path, len));
+    TypeInfoFile file = { 0 };
+    if (entry && ((TypeInfoFile*)entry->value)->path)
+    {
+        TypeInfoFile* old = (TypeInfoFile*)entry->value;
+        file = *old;
+        memset(old, 0, sizeof(TypeInfoFile));
+        if (!meta__type_info_fresh(&file))
+        {
+            sb_push(walk->to_parse, sb_count(walk->files));
+        }
+    }
+    else
+    {
+        file.path = (char*)malloc(len + 1);
+        assert(file.path);
+        memcpy(file.path, path, len + 1);
+        sb_push(walk->to_parse, sb_count(walk->files));
+    }
+    file.name = file.path + (name - path);
+    file.dir_id = walk->dir_id;
+    sb_push(walk->files, file);
+}
+
+// Returns an sb_ array with one entry per C file under directory_path. Files
+// of `previous` (an sb_ array, may be NULL) that are still there and haven't
+// changed are moved to the result instead of being parsed again; the rest of
+// `previous` is freed. The number of files parsed goes to *num_parsed.
+static TypeInfoFile* meta__type_info_scan(
+        const char* directory_path,
+        TypeInfoFile* previous,
+        TypeInfoDirFunc dir_func,
+        void* user_data,
+        int* num_parsed)
+{
+    MetaStrMap reuse = { 0 };
+    meta_strmap_init(&reuse, sb_count(previous));
+    for (int i = 0; i < sb_count(previous); ++i)
+    {
+        size_t len = strlen(previous[i].path);
+        meta_strmap_insert(&reuse, previous[i].path, len, meta_hash(previous[i].path, len), &previous[i]);
+    }
+
+    // Serial, so that the output keeps the same order from run to run.
+    static const char* ignore[] = { ".git", ".hg", ".svn" };
+    SglWalkOptions options = { 0 };
+    options.extensions = meta__type_info_exts;
+    options.num_extensions = sizeof(meta__type_info_exts) / sizeof(char*);
+    options.ignore = ignore;
+    options.num_ignore = sizeof(ignore) / sizeof(char*);
+
+    TypeInfoWalk walk = { 0 };
+    walk.reuse = &reuse;
+    walk.dir_func = dir_func;
+    walk.user_data = user_data;
+    double start = meta__now();
+    if (sgl_walk_dir(directory_path, &options, meta__type_info_walk_func, &walk) < 0)
+    {
+        fprintf(stderr, "Could not open directory %s\n", directory_path);
+    }
+    meta__stats.walk_seconds += meta__now() - start;
+    TypeInfoFile* files = walk.files;
+    int* to_parse = walk.to_parse;
+    meta__stats.files += (uint64_t)sb_count(files);
+    meta__stats.files_parsed += (uint64_t)sb_count(to_parse);
+
+    meta__type_info_parse_files(files, to_parse, sb_count(to_parse));
+    if (num_parsed)
+    {
+        *num_parsed = sb_count(to_parse);
+    }
+    meta__sb_free(to_parse);
+
+    // Files in `previous` keep their keys alive until here.
+    meta_strmap_free(&reuse);
+    for (int i = 0; i < sb_count(previous); ++i)
+    {
+        if (previous[i].path)
+        {
+            meta__type_info_free_file(&previous[i]);
+        }
+    }
+    meta__sb_free(previous);
+    return files;
+}
+
+static void meta__type_info_free(TypeInfoFile* files)
+{
+    for (int i = 0; i < sb_count(files); ++i)
+    {
+        meta__type_info_free_file(&files[i]);
+    }
+    meta__sb_free(files);
+}
+
+// Collapses "." and ".." components and repeated separators, so that a file
+// has one path however it is reached. `out` needs strlen(path) + 2 bytes.
+static void meta__path_normalize(const char* path, char* out)
+{
+    size_t len = 0;
+    size_t root = 0;  // Start of the components ".." may remove
+    if (*path == '/' || *path == '\\')
+    {
+        out[len++] = '/';
+        root = len;
+    }
+    const char* c = path;
+    while (*c)
+    {
+        while (*c == '/' || *c == '\\')
+        {
+            ++c;
+        }
+        const char* component = c;
+        while (*c && *c != '/' && *c != '\\')
+        {
+            ++c;
+        }
+        size_t component_len = (size_t)(c - component);
+        if (component_len == 0 || (component_len == 1 && component[0] == '.'))
+        {
+            continue;
+        }
+        if (component_len == 2 && component[0] == '.' && component[1] == '.')
+        {
+            size_t last = len;
+            while (last > root && out[last - 1] != '/')
+            {
+                --last;
+            }
+            if (len > root && !(len - last == 2 && out[last] == '.' && out[last + 1] == '.'))
+            {
+                len = last > root ? last - 1 : root;
+                continue;
+            }
+            if (root && len == root)
+            {
+                continue;  // "/.." is "/"
+            }
+        }
+        if (len > root)
+        {
+            out[len++] = '/';
+        }
+        memcpy(out + len, component, component_len);
+        len += component_len;
+    }
+    if (len == 0)
+    {
+        out[len++] = '.';
+    }
+    out[len] = '\0';
+}
+
+// Which files each file includes, as indices into the file array. Only
+// #include "name" is followed, relative to the including file, as the
+// preprocessor looks first. An include that isn't one of the scanned files
+// makes the file `open`: it may get types from somewhere we haven't seen.
+typedef struct
+{
+    int*        first_dep;  // Per file, then one past the last: its range in `deps`
+    int*        deps;       // sb_
+    uint8_t*    open;
+} TypeInfoGraph;
+
+static void meta__type_info_graph(TypeInfoFile* files, TypeInfoGraph* graph)
+{
+    int num_files = sb_count(files);
+    graph->first_dep = (int*)malloc((num_files + 1) * sizeof(int));
+    graph->open = (uint8_t*)calloc(num_files + 1, 1);
+    graph->deps = NULL;
+    assert(graph->first_dep && graph->open);
+
+    MetaStrMap paths = { 0 };
+    meta_strmap_init(&paths, num_files);
+    char** normalized = (char**)malloc((num_files + 1) * sizeof(char*));
+    assert(normalized);
+    for (int f = 0; f < num_files; ++f)
+    {
+        normalized[f] = (char*)malloc(strlen(files[f].path) + 2);
+        assert(normalized[f]);
+        meta__path_normalize(files[f].path, normalized[f]);
+        size_t len = strlen(normalized[f]);
+        meta_strmap_insert(&paths, normalized[f], len, meta_hash(normalized[f], len), (void*)(intptr_t)f);
+    }
+
+    char* candidate = NULL;  // sb_
+    char* resolved = NULL;   // sb_
+    for (int f = 0; f < num_files; ++f)
+    {
+        graph->first_dep[f] = sb_count(graph->deps);
+        const char* dir = normalized[f];
+        const char* slash = strrchr(dir, '/');
+        size_t dir_len = slash ? (size_t)(slash - dir) + 1 : 0;
+        for (int i = 0; i < sb_count(files[f].includes); ++i)
+        {
+            const char* include = files[f].includes[i];
+            size_t include_len = strlen(include);
+            if (candidate)
+            {
+                sgl__sbcount(candidate) = 0;
+            }
+            // Absolute includes don't get the directory.
+            size_t prefix = (include[0] == '/' || include[0] == '\\' || include[1] == ':') ? 0 : dir_len;
+            memcpy(sb_add(candidate, (int)(prefix + include_len + 1)), dir, prefix);
+            memcpy(candidate + prefix, include, include_len + 1);
+            if (resolved)
+            {
+                sgl__sbcount(resolved) = 0;
+            }
+            (void)sb_add(resolved, (int)(prefix + include_len + 2));
+            meta__path_normalize(candidate, resolved);
+
+            size_t len = strlen(resolved);
+            MetaStrMapEntry* entry = meta_strmap_find(&paths, resolved, len, meta_hash(resolved, len));
+            if (entry)
+            {
+                sb_push(graph->deps, (int)(intptr_t)entry->value);
+            }
+            else
+            {
+                graph->open[f] = 1;
+            }
+        }
+    }
+    graph->first_dep[num_files] = sb_count(graph->deps);
+
+    meta__sb_free(candidate);
+    meta__sb_free(resolved);
+    meta_strmap_free(&paths);
+    for (int f = 0; f < num_files; ++f)
+    {
+        free(normalized[f]);
+    }
+    free(normalized);
+}
+
+static void meta__type_info_graph_free(TypeInfoGraph* graph)
+{
+    free(graph->first_dep);
+    free(graph->open);
+    meta__sb_free(graph->deps);
+}
+
+// Returns 1 if the two files include the same files.
+static int meta__type_info_same_deps(TypeInfoGraph* graph, int a, int b)
+{
+    int count = graph->first_dep[a + 1] - graph->first_dep[a];
+    return count == graph->first_dep[b + 1] - graph->first_dep[b] &&
+           (!count || !memcmp(graph->deps + graph->first_dep[a], graph->deps + graph->first_dep[b], count * sizeof(int)));
+}
+
+// Marks the files `file` includes, directly or not, with `mark`. Returns 1 if
+// any of them is open. The file itself is only marked if it includes itself,
+// so files that include the same files can share the marks.
+static int meta__type_info_reach(TypeInfoGraph* graph, int file, int* marks, int mark, int** stack)
+{
+    int open = 0;
+    if (*stack)
+    {
+        sgl__sbcount(*stack) = 0;
+    }
+    for (int d = graph->first_dep[file]; d < graph->first_dep[file + 1]; ++d)
+    {
+        if (marks[graph->deps[d]] != mark)
+        {
+            marks[graph->deps[d]] = mark;
+            sb_push(*stack, graph->deps[d]);
+        }
+    }
+    while (sb_count(*stack))
+    {
+        int f = (*stack)[--sgl__sbcount(*stack)];
+        open |= graph->open[f];
+        for (int d = graph->first_dep[f]; d < graph->first_dep[f + 1]; ++d)
+        {
+            int dep = graph->deps[d];
+            if (marks[dep] != mark)
+            {
+                marks[dep] = mark;
+                sb_push(*stack, dep);
+            }
+        }
+    }
+    return open;
+}
+
+// Writes the type info for all the files. Returns 1 if the output changed, 0
+// if it was up to date, -1 if it can't be written.
+static int meta__type_info_write(const char* output_path, TypeInfoFile* files)
+{
+    double start = meta__now();
+    MetaSink sink;
+    meta_sink_memory(&sink);
+
+    // Known types: keywords and the types declared in every file. A file
+    // only sees the types of the files it includes, unless it is open; then
+    // it sees all of them. Every file was parsed once, and its includes use
+    // its types from here instead of parsing it again.
+    size_t num_types = 0;
+    for (int f = 0; f < sb_count(files); ++f)
+    {
+        num_types += sb_count(files[f].types);
+    }
+    MetaStrMap symbols = { 0 };
+    meta__symbols_init(&symbols, num_types);
+    MetaStrMap declared_in = { 0 };  // Type name -> 1 + its first entry in `declarations`
+    meta_strmap_init(&declared_in, num_types);
+    int* declarations = NULL;        // sb_, pairs of file and the next entry for the same name, or -1
+    for (int f = 0; f < sb_count(files); ++f)
+    {
+        for (int i = 0; i < sb_count(files[f].types); ++i)
+        {
+            const char* type = files[f].types[i];
+            size_t type_len = strlen(type);
+            meta__symbols_add(&symbols, type, type_len, SYMBOL_TYPE);
+            MetaStrMapEntry* entry = meta_strmap_insert(&declared_in, type, type_len, meta_hash(type, type_len), NULL);
+            sb_push(declarations, f);
+            sb_push(declarations, (int)(intptr_t)entry->value - 1);
+            entry->value = (void*)(intptr_t)(sb_count(declarations) - 1);
+        }
+    }
+    meta__stats.known_types += declared_in.count;
+    TypeInfoGraph graph;
+    meta__type_info_graph(files, &graph);
+    int* marks = (int*)calloc(sb_count(files) + 1, sizeof(int));
+    assert(marks);
+    int* stack = NULL;  // sb_
+    int last_reached = -1;   // The last file marked, with this result
+    int last_open = 0;
+    MetaStrMap* keywords = meta__type_info_keyword_map();
+
+    // Do output!
+    for (int f = 0; f < sb_count(files); ++f)
+    {
+        char** type_decls = files[f].decls;
+        int reached = 0;  // Files this one includes are marked `mark`
+        int mark = 0;
+        int open = 0;
+        int begin = 0;
+        int end = 0;
+        while (begin < sb_count(type_decls))
+        {
+            // Move end to next 0
+            while (type_decls[++end] != 0);
+            ++meta__stats.declarations;
+            char* var_name = type_decls[begin];
+            char* func_name = type_decls[end - 1];
+            int is_valid = 1;
+            for (int i = begin + 1; i < end - 1 && is_valid; ++i)
+            {
+                size_t type_len = strlen(type_decls[i]);
+                if (!(meta__symbols_find(&symbols, type_decls[i], type_len) & SYMBOL_TYPE))
+                {
+                    is_valid = 0;
+                    break;
+                }
+                if (meta__symbols_find(keywords, type_decls[i], type_len) & SYMBOL_TYPE)
+                {
+                    continue;
+                }
+                if (!reached)
+                {
+                    if (last_reached < 0 || !meta__type_info_same_deps(&graph, f, last_reached))
+                    {
+                        last_open = meta__type_info_reach(&graph, f, marks, f + 1, &stack);
+                        last_reached = f;
+                    }
+                    mark = last_reached + 1;
+                    open = last_open || graph.open[f];
+                    reached = 1;
+                }
+                if (!open)
+                {
+                    MetaStrMapEntry* entry = meta_strmap_find(&declared_in, type_decls[i], type_len,
+                                                              meta_hash(type_decls[i], type_len));
+                    int at = (int)(intptr_t)entry->value - 1;
+                    while (at >= 0 && declarations[at] != f && marks[declarations[at]] != mark)
+                    {
+                        at = declarations[at + 1];
                     }
-                    // Process all C files.
-                    if (accepted)
+                    is_valid = at >= 0;
+                }
+            }
+            // We had to go through the loop
+            if (end - begin < 3)
+            {
+                is_valid = 0;
+            }
+            if (is_valid)
+            {
+                ++meta__stats.valid_declarations;
+                if (meta__verbose)
+                {
+                    puts("==== Valid type");
+                    puts(func_name);
+                }
+                // #ifndef ADC_TYPE__FUNC__<func>__NAME__<var>
+                // #define ADC_TYPE__FUNC__<func>__NAME__<var>  <type> <type> ...
+                // #endif
+                for (int line = 0; line < 2; ++line)
+                {
+                    meta_sink_write(&sink, line ? "#define " : "#ifndef ", 8);
+                    meta_sink_write(&sink, "ADC_TYPE__FUNC__", 16);
+                    meta_sink_write(&sink, func_name, strlen(func_name));
+                    meta_sink_write(&sink, "__NAME__", 8);
+                    meta_sink_write(&sink, var_name, strlen(var_name));
+                    meta_sink_write(&sink, line ? " " : "\n", 1);
+                }
+                for (int i = end - 2; i >= begin + 1; --i)
+                {
+                    char* type = type_decls[i];
+                    size_t type_len = strlen(type);
+                    // Filter type qualifiers (const static volatile)
+                    if (!(meta__symbols_find(&symbols, type, type_len) & SYMBOL_QUALIFIER))
                     {
-                        printf("[...] Processing %s\n", fname);
-                        process_file(fname);
+                        meta_sink_write(&sink, " ", 1);
+                        meta_sink_write(&sink, type, type_len);
+                        meta_sink_write(&sink, " ", 1);
+                        if (meta__verbose)
+                        {
+                            puts(type);
+                        }
                     }
                 }
+                if (meta__verbose)
+                {
+                    puts(var_name);
+                }
+                meta_sink_write(&sink, "\n#endif\n", 8);
+            }
+            begin = end + 1;
+        }
+    }
+    meta_strmap_free(&symbols);
+    meta_strmap_free(&declared_in);
+    meta__sb_free(declarations);
+    meta__type_info_graph_free(&graph);
+    meta__sb_free(stack);
+    free(marks);
+
+    int result = meta_write_if_changed(output_path, sink.data, sink.count);
+    if (result < 0)
+    {
+        fprintf(stderr, "Could not open file %s for writing.\n", output_path);
+    }
+    meta_sink_close(&sink);
+    meta__stats.emit_seconds += meta__now() - start;
+    return result;
+}
+
+// -- Type info cache.
+// Little-endian, written and read by the same machine:
+//      "ADCTYPES" version num_files checksum (meta_hash64 of the rest)
+//      per file:   path_len path size mtime content_hash
+//                  memory_size num_types num_decls num_includes memory
+//                  types: offsets into memory
+//                  decls: offsets into memory, ~0 for the NULL separators
+//                  includes: offsets into memory
+// Bump the version when the parser's results change.
+
+#define META_TYPE_INFO_CACHE_VERSION 2
+
+static char* meta__type_info_cache_path(const char* output_path)
+{
+    size_t path_len = strlen(output_path);
+    char* cache_path = (char*)malloc(path_len + 7);
+    assert(cache_path);
+    memcpy(cache_path, output_path, path_len);
+    memcpy(cache_path + path_len, ".cache", 7);
+    return cache_path;
+}
+
+static void meta__sink_u32(MetaSink* sink, uint32_t value)
+{
+    meta_sink_write(sink, (const char*)&value, sizeof(value));
+}
+
+static void meta__sink_u64(MetaSink* sink, uint64_t value)
+{
+    meta_sink_write(sink, (const char*)&value, sizeof(value));
+}
+
+static void meta__type_info_cache_save(const char* output_path, TypeInfoFile* files)
+{
+    double start = meta__now();
+    MetaSink sink;
+    meta_sink_memory(&sink);
+    uint32_t num_files = 0;
+    for (int f = 0; f < sb_count(files); ++f)
+    {
+        num_files += files[f].memory != NULL;
+    }
+    meta_sink_write(&sink, "ADCTYPES", 8);
+    meta__sink_u32(&sink, META_TYPE_INFO_CACHE_VERSION);
+    meta__sink_u32(&sink, num_files);
+    meta__sink_u64(&sink, 0);
+    size_t header_size = sink.count;
+    for (int f = 0; f < sb_count(files); ++f)
+    {
+        TypeInfoFile* file = &files[f];
+        if (!file->memory)
+        {
+            continue;
+        }
+        const char* memory = (const char*)file->memory;
+        size_t path_len = strlen(file->path);
+        meta__sink_u32(&sink, (uint32_t)path_len);
+        meta_sink_write(&sink, file->path, path_len);
+        meta__sink_u64(&sink, file->size);
+        meta__sink_u64(&sink, file->mtime);
+        meta__sink_u64(&sink, file->content_hash);
+        meta__sink_u32(&sink, (uint32_t)file->memory_size);
+        meta__sink_u32(&sink, (uint32_t)sb_count(file->types));
+        meta__sink_u32(&sink, (uint32_t)sb_count(file->decls));
+        meta__sink_u32(&sink, (uint32_t)sb_count(file->includes));
+        meta_sink_write(&sink, memory, file->memory_size);
+        for (int i = 0; i < sb_count(file->types); ++i)
+        {
+            meta__sink_u32(&sink, (uint32_t)(file->types[i] - memory));
+        }
+        for (int i = 0; i < sb_count(file->decls); ++i)
+        {
+            meta__sink_u32(&sink, file->decls[i] ? (uint32_t)(file->decls[i] - memory) : ~0u);
+        }
+        for (int i = 0; i < sb_count(file->includes); ++i)
+        {
+            meta__sink_u32(&sink, (uint32_t)(file->includes[i] - memory));
+        }
+    }
+
+    uint64_t checksum = meta_hash64(sink.data + header_size, sink.count - header_size);
+    memcpy(sink.data + header_size - sizeof(checksum), &checksum, sizeof(checksum));
+
+    char* cache_path = meta__type_info_cache_path(output_path);
+    if (meta_write_if_changed(cache_path, sink.data, sink.count) < 0)
+    {
+        fprintf(stderr, "Could not write type info cache %s\n", cache_path);
+    }
+    free(cache_path);
+    meta_sink_close(&sink);
+    meta__stats.emit_seconds += meta__now() - start;
+}
+
+typedef struct
+{
+    const char* at;
+    const char* end;
+} TypeInfoCacheReader;
+
+static int meta__cache_read(TypeInfoCacheReader* reader, void* out, size_t size)
+{
+    if ((size_t)(reader->end - reader->at) < size)
+    {
+        return 0;
+    }
+    memcpy(out, reader->at, size);
+    reader->at += size;
+    return 1;
+}
+
+// Reads one file's offsets into `strings`, an sb_ array. Returns 0 if an
+// offset is out of range.
+static int meta__cache_read_strings(TypeInfoCacheReader* reader, TypeInfoFile* file, uint32_t count, char*** strings)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t offset;
+        if (!meta__cache_read(reader, &offset, sizeof(offset)) ||
+            (offset != ~0u && offset >= file->memory_size))
+        {
+            return 0;
+        }
+        sb_push(*strings, offset == ~0u ? NULL : (char*)file->memory + offset);
+    }
+    return 1;
+}
+
+// Returns the files of <output_path>.cache as an sb_ array, to pass to
+// meta__type_info_scan as `previous`. NULL if there is no usable cache.
+static TypeInfoFile* meta__type_info_cache_load(const char* output_path)
+{
+    char* cache_path = meta__type_info_cache_path(output_path);
+    MetaMappedFile mapped;
+    int opened = meta_map_file(cache_path, &mapped);
+    free(cache_path);
+    if (!opened)
+    {
+        return NULL;
+    }
+
+    TypeInfoCacheReader reader = { mapped.data, mapped.data + mapped.size };
+    char magic[8];
+    uint32_t version = 0;
+    uint32_t num_files = 0;
+    uint64_t checksum = 0;
+    int ok = meta__cache_read(&reader, magic, 8) && !memcmp(magic, "ADCTYPES", 8) &&
+             meta__cache_read(&reader, &version, sizeof(version)) &&
+             version == META_TYPE_INFO_CACHE_VERSION &&
+             meta__cache_read(&reader, &num_files, sizeof(num_files)) &&
+             meta__cache_read(&reader, &checksum, sizeof(checksum)) &&
+             meta_hash64(reader.at, (size_t)(reader.end - reader.at)) == checksum;
+
+    TypeInfoFile* files = NULL;
+    for (uint32_t f = 0; ok && f < num_files; ++f)
+    {
+        TypeInfoFile file = { 0 };
+        uint32_t path_len, memory_size, num_types, num_decls, num_includes;
+        ok = meta__cache_read(&reader, &path_len, sizeof(path_len)) &&
+             (size_t)(reader.end - reader.at) >= path_len;
+        if (ok)
+        {
+            file.path = (char*)malloc(path_len + 1);
+            assert(file.path);
+            meta__cache_read(&reader, file.path, path_len);
+            file.path[path_len] = '\0';
+            ok = meta__cache_read(&reader, &file.size, sizeof(file.size)) &&
+                 meta__cache_read(&reader, &file.mtime, sizeof(file.mtime)) &&
+                 meta__cache_read(&reader, &file.content_hash, sizeof(file.content_hash)) &&
+                 meta__cache_read(&reader, &memory_size, sizeof(memory_size)) &&
+                 meta__cache_read(&reader, &num_types, sizeof(num_types)) &&
+                 meta__cache_read(&reader, &num_decls, sizeof(num_decls)) &&
+                 meta__cache_read(&reader, &num_includes, sizeof(num_includes)) &&
+                 (size_t)(reader.end - reader.at) >= memory_size;
+        }
+        if (ok)
+        {
+            // Every string ends inside the block.
+            file.memory_size = memory_size;
+            file.memory = malloc(memory_size + 1);
+            assert(file.memory);
+            meta__cache_read(&reader, file.memory, memory_size);
+            ok = (memory_size == 0 || ((char*)file.memory)[memory_size - 1] == '\0') &&
+                 meta__cache_read_strings(&reader, &file, num_types, &file.types) &&
+                 meta__cache_read_strings(&reader, &file, num_decls, &file.decls) &&
+                 meta__cache_read_strings(&reader, &file, num_includes, &file.includes);
+        }
+        if (ok)
+        {
+            // Separators are NULL, and there is one after the last declaration.
+            for (int i = 0; i < sb_count(file.types); ++i)
+            {
+                ok &= file.types[i] != NULL;
+            }
+            for (int i = 0; i < sb_count(file.includes); ++i)
+            {
+                ok &= file.includes[i] != NULL;
+            }
+            ok &= !sb_count(file.decls) || !sb_last(file.decls);
+        }
+        sb_push(files, file);
+    }
+    meta_unmap_file(&mapped);
+
+    if (!ok)
+    {
+        fprintf(stderr, "Ignoring type info cache for %s, it is from another version or damaged\n", output_path);
+        meta__type_info_free(files);
+        files = NULL;
+    }
+    return files;
+}
+
+int meta_type_info(
+        const char* output_path,
+        const char* directory_path)
+{
+    assert(output_path);
+    assert(directory_path);
+
+    int num_parsed = 0;
+    double start = meta__now();
+    TypeInfoFile* previous = meta__type_info_cache_load(output_path);
+    meta__stats.read_seconds += meta__now() - start;
+    TypeInfoFile* files = meta__type_info_scan(directory_path, previous, NULL, NULL, &num_parsed);
+    int result = meta__type_info_write(output_path, files);
+    meta__type_info_cache_save(output_path, files);
+    if (meta__verbose)
+    {
+        printf("Type info: %d files, %d parsed, peak RSS %.1f MB\n",
+               sb_count(files), num_parsed, meta__peak_rss() / (1024.0 * 1024.0));
+    }
+    meta__type_info_free(files);
+    return result;
+}
+
+// ==== Watch mode
+
+#if defined(__linux__)
+
+// Events come in bursts (an editor's save is several of them), so after the
+// first one, wait this long for the rest before regenerating.
+#define META_WATCH_SETTLE_MS 5
+
+typedef struct
+{
+    int     wd;
+    char*   path;   // As first seen
+} WatchDir;
+
+typedef struct
+{
+    char*           output_path;
+    char*           directory_path;
+    TypeInfoFile*   files;          // sb_
+    int*            wds;            // sb_ directories in the tree
+    int             rescan;         // Files were added or removed
+    int             dirty;          // Some file has to be parsed again
+} WatchTypeInfo;
+
+typedef struct
+{
+    int         wd;
+    const char* name;   // File name part of the template path
+    int         changed;
+} WatchTemplate;
+
+struct MetaWatch_s
+{
+    int             fd;
+    WatchDir*       dirs;       // sb_
+
+    MetaJobList*    jobs;
+    WatchTemplate*  templates;  // sb_, parallel to jobs->templates
+
+    WatchTypeInfo*  type_infos; // sb_
+    int*            dirty_files;// sb_ of (type info index, file index) pairs
+};
+
+MetaWatch* meta_watch_create()
+{
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+    {
+        perror("inotify_init1");
+        return NULL;
+    }
+    MetaWatch* watch = (MetaWatch*)calloc(1, sizeof(MetaWatch));
+    assert(watch);
+    watch->fd = fd;
+    return watch;
+}
+
+// Watches a directory. Returns its watch descriptor, or -1.
+static int meta__watch_dir(MetaWatch* watch, const char* dir_path)
+{
+    int wd = inotify_add_watch(watch->fd, dir_path,
+                               IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO);
+    if (wd < 0)
+    {
+        fprintf(stderr, "Could not watch %s\n", dir_path);
+        return -1;
+    }
+    for (int i = 0; i < sb_count(watch->dirs); ++i)
+    {
+        if (watch->dirs[i].wd == wd)
+        {
+            return wd;
+        }
+    }
+    size_t len = strlen(dir_path);
+    WatchDir dir = { wd, (char*)malloc(len + 1) };
+    assert(dir.path);
+    memcpy(dir.path, dir_path, len + 1);
+    sb_push(watch->dirs, dir);
+    return wd;
+}
+
+void meta_watch_jobs(MetaWatch* watch, MetaJobList* jobs)
+{
+    assert(!watch->jobs);
+    watch->jobs = jobs;
+    for (int i = 0; i < sb_count(jobs->templates); ++i)
+    {
+        // inotify watches directories, so that editors that save by renaming
+        // a new file over the old one are seen too.
+        const char* path = jobs->templates[i];
+        const char* slash = strrchr(path, '/');
+        WatchTemplate tmpl = { -1, slash ? slash + 1 : path, 0 };
+        if (slash)
+        {
+            size_t dir_len = slash == path ? 1 : (size_t)(slash - path);
+            char* dir = (char*)malloc(dir_len + 1);
+            assert(dir);
+            memcpy(dir, path, dir_len);
+            dir[dir_len] = '\0';
+            tmpl.wd = meta__watch_dir(watch, dir);
+            free(dir);
+        }
+        else
+        {
+            tmpl.wd = meta__watch_dir(watch, ".");
+        }
+        sb_push(watch->templates, tmpl);
+    }
+
+    meta__jobs_compile(jobs);
+    meta__jobs_run_groups(jobs, 0, NULL, 0);
+}
+
+typedef struct
+{
+    MetaWatch*      watch;
+    WatchTypeInfo*  info;
+} WatchScan;
+
+static int meta__watch_type_info_dir(void* user_data, const char* dir_path)
+{
+    WatchScan* scan = (WatchScan*)user_data;
+    int wd = meta__watch_dir(scan->watch, dir_path);
+    sb_push(scan->info->wds, wd);
+    return wd;
+}
+
+// Rescans or re-parses, then rewrites the output if it changed.
+static int meta__watch_update_type_info(MetaWatch* watch, WatchTypeInfo* info)
+{
+    if (info->rescan)
+    {
+        if (info->wds)
+        {
+            sgl__sbcount(info->wds) = 0;
+        }
+        WatchScan scan = { watch, info };
+        info->files = meta__type_info_scan(info->directory_path, info->files, meta__watch_type_info_dir, &scan, NULL);
+    }
+    info->rescan = 0;
+    info->dirty = 0;
+    int changed = meta__type_info_write(info->output_path, info->files) == 1;
+    meta__type_info_cache_save(info->output_path, info->files);
+    return changed;
+}
+
+void meta_watch_type_info(MetaWatch* watch, const char* output_path, const char* directory_path)
+{
+    WatchTypeInfo info = { 0 };
+    size_t output_len = strlen(output_path);
+    size_t dir_len = strlen(directory_path);
+    info.output_path = (char*)malloc(output_len + 1);
+    info.directory_path = (char*)malloc(dir_len + 1);
+    assert(info.output_path && info.directory_path);
+    memcpy(info.output_path, output_path, output_len + 1);
+    memcpy(info.directory_path, directory_path, dir_len + 1);
+    double start = meta__now();
+    info.files = meta__type_info_cache_load(output_path);
+    meta__stats.read_seconds += meta__now() - start;
+    info.rescan = 1;
+    sb_push(watch->type_infos, info);
+    meta__watch_update_type_info(watch, &sb_last(watch->type_infos));
+}
+
+static void meta__watch_event(MetaWatch* watch, const struct inotify_event* event)
+{
+    if (!event->len)
+    {
+        return;
+    }
+    int structural = (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) ||
+                     (event->mask & IN_ISDIR);
+
+    if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+    {
+        for (int i = 0; i < sb_count(watch->templates); ++i)
+        {
+            WatchTemplate* tmpl = &watch->templates[i];
+            if (tmpl->wd == event->wd && !strcmp(tmpl->name, event->name))
+            {
+                tmpl->changed = 1;
+            }
+        }
+    }
+
+    for (int t = 0; t < sb_count(watch->type_infos); ++t)
+    {
+        WatchTypeInfo* info = &watch->type_infos[t];
+        int in_tree = 0;
+        for (int i = 0; i < sb_count(info->wds); ++i)
+        {
+            in_tree |= info->wds[i] == event->wd;
+        }
+        if (!in_tree)
+        {
+            continue;
+        }
+        // New files, subdirectories or renames: walk the tree again. Files
+        // that are still there are not parsed again, unless they changed.
+        if (structural && ((event->mask & IN_ISDIR) || meta__type_info_accepted(event->name)))
+        {
+            info->rescan = 1;
+        }
+        if (!(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)))
+        {
+            continue;
+        }
+        for (int i = 0; i < sb_count(info->files); ++i)
+        {
+            TypeInfoFile* file = &info->files[i];
+            if (file->dir_id != event->wd || strcmp(file->name, event->name))
+            {
+                continue;
+            }
+            int queued = 0;
+            for (int j = 0; j < sb_count(watch->dirty_files); j += 2)
+            {
+                queued |= watch->dirty_files[j] == t && watch->dirty_files[j + 1] == i;
+            }
+            if (!queued)
+            {
+                sb_push(watch->dirty_files, t);
+                sb_push(watch->dirty_files, i);
+            }
+            info->dirty = 1;
+        }
+    }
+}
+
+// Reads every pending event. Returns 0 on error.
+static int meta__watch_read(MetaWatch* watch)
+{
+    char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;)
+    {
+        ssize_t len = read(watch->fd, buffer, sizeof(buffer));
+        if (len < 0)
+        {
+            return errno == EAGAIN;
+        }
+        for (char* p = buffer; p < buffer + len; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            meta__watch_event(watch, event);
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+int meta_watch_poll(MetaWatch* watch, int timeout_ms)
+{
+    struct pollfd pfd = { watch->fd, POLLIN, 0 };
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready <= 0)
+    {
+        return ready < 0 && errno != EINTR ? -1 : 0;
+    }
+    do
+    {
+        if (!meta__watch_read(watch))
+        {
+            perror("inotify");
+            return -1;
+        }
+    } while (poll(&pfd, 1, META_WATCH_SETTLE_MS) > 0);
+
+    int regenerated = 0;
+
+    // Templates: compile the changed ones again, then run the outputs that use them.
+    MetaJobList* jobs = watch->jobs;
+    int* groups = NULL;  // sb_
+    for (int i = 0; i < sb_count(watch->templates); ++i)
+    {
+        if (!watch->templates[i].changed)
+        {
+            continue;
+        }
+        watch->templates[i].changed = 0;
+        MetaTemplate* tmpl = meta_template_compile(jobs->templates[i]);
+        if (!tmpl)
+        {
+            continue;  // Keep the last good one, e.g. while it's half-saved.
+        }
+        meta_template_free(jobs->compiled[i]);
+        jobs->compiled[i] = tmpl;
+        for (int g = 0; g < sb_count(jobs->groups); ++g)
+        {
+            MetaJobGroup* group = &jobs->groups[g];
+            if (jobs->jobs[group->jobs[0]].type != META_JOB_CLEAR)
+            {
+                continue;
+            }
+            int uses = 0;
+            for (int j = 0; j < sb_count(group->jobs); ++j)
+            {
+                MetaJob* job = &jobs->jobs[group->jobs[j]];
+                uses |= job->type == META_JOB_EXPAND && job->template_index == i;
+            }
+            int queued = 0;
+            for (int j = 0; j < sb_count(groups); ++j)
+            {
+                queued |= groups[j] == g;
+            }
+            if (uses && !queued)
+            {
+                sb_push(groups, g);
+            }
+        }
+    }
+    if (sb_count(groups))
+    {
+        meta__jobs_run_groups(jobs, 0, groups, sb_count(groups));
+        regenerated += sb_count(groups);
+    }
+    meta__sb_free(groups);
+
+    // Type info: parse the changed files again, then rewrite the outputs.
+    TypeInfoScratch scratch = { 0 };
+    for (int i = 0; i < sb_count(watch->dirty_files); i += 2)
+    {
+        WatchTypeInfo* info = &watch->type_infos[watch->dirty_files[i]];
+        meta__type_info_parse(&info->files[watch->dirty_files[i + 1]], &scratch);
+    }
+    meta__stats_add(&meta__stats, &scratch.stats);
+    meta__type_info_scratch_free(&scratch);
+    if (watch->dirty_files)
+    {
+        sgl__sbcount(watch->dirty_files) = 0;
+    }
+    for (int t = 0; t < sb_count(watch->type_infos); ++t)
+    {
+        WatchTypeInfo* info = &watch->type_infos[t];
+        if (info->rescan || info->dirty)
+        {
+            regenerated += meta__watch_update_type_info(watch, info);
+        }
+    }
+    return regenerated;
+}
+
+void meta_watch_free(MetaWatch* watch)
+{
+    if (!watch)
+    {
+        return;
+    }
+    if (watch->jobs)
+    {
+        meta__jobs_release(watch->jobs);
+    }
+    for (int i = 0; i < sb_count(watch->type_infos); ++i)
+    {
+        WatchTypeInfo* info = &watch->type_infos[i];
+        meta__type_info_free(info->files);
+        meta__sb_free(info->wds);
+        free(info->output_path);
+        free(info->directory_path);
+    }
+    for (int i = 0; i < sb_count(watch->dirs); ++i)
+    {
+        free(watch->dirs[i].path);
+    }
+    meta__sb_free(watch->type_infos);
+    meta__sb_free(watch->templates);
+    meta__sb_free(watch->dirs);
+    meta__sb_free(watch->dirty_files);
+    close(watch->fd);
+    free(watch);
+}
+
+#endif  // __linux__
+
+// ==== Struct definitions
+
+// One declaration, tokens [begin, end), without the semicolon. e.g. `float *a, b[4]`
+static int meta__parse_fields(
+        MetaStruct* def,
+        const char* src,
+        const MetaToken* tokens,
+        int begin,
+        int end)
+{
+    for (int i = begin; i < end; ++i)
+    {
+        if (meta__token_is_punct(src, &tokens[i], '(') || meta__token_is_punct(src, &tokens[i], ':'))
+        {
+            return 0;  // Function pointer or bit-field
+        }
+    }
+
+    // The base type ends at the first '*', or at the identifier right before
+    // the first '[' / ',' / end.
+    int base_end = begin;
+    while (base_end < end &&
+           !meta__token_is_punct(src, &tokens[base_end], '*') &&
+           !meta__token_is_punct(src, &tokens[base_end], '[') &&
+           !meta__token_is_punct(src, &tokens[base_end], ','))
+    {
+        ++base_end;
+    }
+    if (base_end < end && !meta__token_is_punct(src, &tokens[base_end], '*'))
+    {
+        --base_end;  // That was the name of the first declarator
+    }
+    else if (base_end == end)
+    {
+        --base_end;
+    }
+    if (base_end <= begin)
+    {
+        return 0;
+    }
+
+    size_t base_len = 0;
+    for (int i = begin; i < base_end; ++i)
+    {
+        base_len += tokens[i].len + 1;
+    }
+
+    int i = base_end;
+    while (i < end)
+    {
+        int stars = 0;
+        while (i < end && meta__token_is_punct(src, &tokens[i], '*'))
+        {
+            ++stars;
+            ++i;
+        }
+        // Qualifiers on the pointer (`char* const p`) are dropped.
+        while (i + 1 < end && tokens[i].kind == META_TOKEN_IDENT && tokens[i + 1].kind == META_TOKEN_IDENT)
+        {
+            ++i;
+        }
+        if (i >= end || tokens[i].kind != META_TOKEN_IDENT)
+        {
+            return 0;
+        }
+        const MetaToken* name = &tokens[i++];
+
+        int array_count = 0;
+        while (i < end && meta__token_is_punct(src, &tokens[i], '['))
+        {
+            if (i + 2 >= end || tokens[i + 1].kind != META_TOKEN_NUMBER ||
+                !meta__token_is_punct(src, &tokens[i + 2], ']'))
+            {
+                return 0;  // Sizes have to be literals
+            }
+            int count = atoi(src + tokens[i + 1].offset);
+            array_count = array_count ? array_count * count : count;
+            i += 3;
+        }
+        if (i < end && !meta__token_is_punct(src, &tokens[i], ','))
+        {
+            return 0;
+        }
+        ++i;
+
+        MetaField field = { 0 };
+        field.type = (char*)malloc(base_len + stars + 1);
+        assert(field.type);
+        char* out = field.type;
+        for (int t = begin; t < base_end; ++t)
+        {
+            if (t != begin)
+            {
+                *out++ = ' ';
+            }
+            memcpy(out, src + tokens[t].offset, tokens[t].len);
+            out += tokens[t].len;
+        }
+        for (int s = 0; s < stars; ++s)
+        {
+            *out++ = '*';
+        }
+        *out = '\0';
+        field.name = meta__strndup(src + name->offset, name->len);
+        field.array_count = array_count;
+        sb_push(def->fields, field);
+    }
+    return 1;
+}
+
+// Body tokens (open, close), exclusive.
+static void meta__parse_struct_body(
+        MetaStruct* def,
+        const char* src,
+        const MetaToken* tokens,
+        int num_tokens,
+        int open,
+        int close)
+{
+    int decl_begin = open + 1;
+    for (int i = open + 1; i < close; ++i)
+    {
+        if (meta__token_is_punct(src, &tokens[i], '{'))
+        {
+            def->is_plain = 0;  // Nested struct or union
+            i = meta__matching_token(src, tokens, num_tokens, i);
+        }
+        else if (meta__token_is_punct(src, &tokens[i], ';'))
+        {
+            if (def->is_plain && !meta__parse_fields(def, src, tokens, decl_begin, i))
+            {
+                def->is_plain = 0;
+            }
+            decl_begin = i + 1;
+        }
+        else if (tokens[i].kind == META_TOKEN_DIRECTIVE)
+        {
+            def->is_plain = 0;
+            decl_begin = i + 1;
+        }
+    }
+}
+
+static MetaStruct* meta__parse_structs_tokens(const char* src, const MetaToken* tokens, int num_tokens)
+{
+    MetaStruct* structs = NULL;
+    int depth = 0;
+    for (int i = 0; i < num_tokens; ++i)
+    {
+        const MetaToken* token = &tokens[i];
+        if (meta__token_is_punct(src, token, '{'))
+        {
+            ++depth;
+        }
+        else if (meta__token_is_punct(src, token, '}'))
+        {
+            --depth;
+        }
+        if (depth != 0 || !meta__token_is(src, token, "struct"))
+        {
+            continue;
+        }
+
+        int is_typedef = i > 0 && meta__token_is(src, &tokens[i - 1], "typedef");
+        int j = i + 1;
+        const MetaToken* tag = NULL;
+        if (j < num_tokens && tokens[j].kind == META_TOKEN_IDENT)
+        {
+            tag = &tokens[j++];
+        }
+        if (j >= num_tokens || !meta__token_is_punct(src, &tokens[j], '{'))
+        {
+            continue;  // Forward declaration or a variable
+        }
+        int close = meta__matching_token(src, tokens, num_tokens, j);
+
+        MetaStruct def = { 0 };
+        def.is_plain = 1;
+        if (tag)
+        {
+            def.tag = meta__strndup(src + tag->offset, tag->len);
+        }
+        if (is_typedef && close + 1 < num_tokens && tokens[close + 1].kind == META_TOKEN_IDENT)
+        {
+            def.name = meta__strndup(src + tokens[close + 1].offset, tokens[close + 1].len);
+        }
+        else if (tag)
+        {
+            def.name = (char*)malloc(tag->len + 8);
+            assert(def.name);
+            memcpy(def.name, "struct ", 7);
+            memcpy(def.name + 7, src + tag->offset, tag->len);
+            def.name[tag->len + 7] = '\0';
+        }
+
+        if (def.name)
+        {
+            meta__parse_struct_body(&def, src, tokens, num_tokens, j, close);
+            sb_push(structs, def);
+        }
+        else
+        {
+            free(def.tag);
+        }
+        i = close;
+    }
+    return structs;
+}
+
+MetaStruct* meta_parse_structs(const char* path)
+{
+    MetaMappedFile mapped;
+    if (!meta_map_file(path, &mapped))
+    {
+        fprintf(stderr, "Could not open file for processing, %s\n", path);
+        return NULL;
+    }
+    MetaToken* tokens = meta_lex_c(mapped.data, mapped.size);
+    MetaStruct* structs = meta__parse_structs_tokens(mapped.data, tokens, sb_count(tokens));
+    meta_free_tokens(tokens);
+    meta_unmap_file(&mapped);
+    return structs;
+}
+
+const MetaStruct* meta_find_struct(const MetaStruct* structs, const char* name)
+{
+    for (int i = 0; i < sb_count(structs); ++i)
+    {
+        const MetaStruct* def = &structs[i];
+        if (!strcmp(def->name, name) || (def->tag && !strcmp(def->tag, name)))
+        {
+            return def;
+        }
+    }
+    return NULL;
+}
+
+void meta_free_structs(MetaStruct* structs)
+{
+    for (int i = 0; i < sb_count(structs); ++i)
+    {
+        MetaStruct* def = &structs[i];
+        for (int f = 0; f < sb_count(def->fields); ++f)
+        {
+            free(def->fields[f].type);
+            free(def->fields[f].name);
+        }
+        meta__sb_free(def->fields);
+        free(def->name);
+        free(def->tag);
+    }
+    meta__sb_free(structs);
+}
+
+// ==== Structure-of-arrays containers
+
+static void meta__sink_printf(MetaSink* sink, const char* fmt, ...)
+{
+    char buffer[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    int len = vsnprintf(buffer, sizeof(buffer), fmt, ap);
+    va_end(ap);
+    assert(len >= 0);
+    if (len < (int)sizeof(buffer))
+    {
+        meta_sink_write(sink, buffer, (size_t)len);
+        return;
+    }
+    // Whole functions with long names.
+    char* big = (char*)malloc((size_t)len + 1);
+    assert(big);
+    va_start(ap, fmt);
+    vsnprintf(big, (size_t)len + 1, fmt, ap);
+    va_end(ap);
+    meta_sink_write(sink, big, (size_t)len);
+    free(big);
+}
+
+// Identifier to prefix generated names with: the typedef name, or the tag.
+static const char* meta__struct_ident(const MetaStruct* def)
+{
+    return strncmp(def->name, "struct ", 7) ? def->name : def->tag;
+}
+
+int meta_soa_sink(MetaSink* sink, const MetaStruct* def)
+{
+    if (!def || !def->is_plain || !sb_count(def->fields))
+    {
+        return 0;
+    }
+    const char* value_type = def->name;
+    const char* ident = meta__struct_ident(def);
+    int num_fields = sb_count(def->fields);
+
+    meta__sink_printf(sink, "//SoA: %s\n\n", value_type);
+    meta__sink_printf(sink, "#include <stdint.h>\n#include <stdlib.h>\n#include <string.h>\n\n");
+
+    // Container
+    meta__sink_printf(sink, "typedef struct\n{\n");
+    meta__sink_printf(sink, "    size_t count;\n");
+    meta__sink_printf(sink, "    size_t capacity;\n");
+    meta__sink_printf(sink, "    void* block;  // All the arrays live in this allocation\n\n");
+    for (int f = 0; f < num_fields; ++f)
+    {
+        const MetaField* field = &def->fields[f];
+        if (field->array_count)
+        {
+            meta__sink_printf(sink, "    %s (*%s)[%d];\n", field->type, field->name, field->array_count);
+        }
+        else
+        {
+            meta__sink_printf(sink, "    %s* %s;\n", field->type, field->name);
+        }
+    }
+    meta__sink_printf(sink, "} %sSoA;\n\n", ident);
+
+    meta__sink_printf(sink,
+            "static inline void %sSoA_init(%sSoA* soa)\n"
+            "{\n"
+            "    memset(soa, 0, sizeof(%sSoA));\n"
+            "}\n\n", ident, ident, ident);
+
+    meta__sink_printf(sink,
+            "static inline void %sSoA_free(%sSoA* soa)\n"
+            "{\n"
+            "    free(soa->block);\n"
+            "    memset(soa, 0, sizeof(%sSoA));\n"
+            "}\n\n", ident, ident, ident);
+
+    // Reserve: one block, every array aligned to a cache line.
+    meta__sink_printf(sink,
+            "// Returns 0 when out of memory.\n"
+            "static inline int %sSoA_reserve(%sSoA* soa, size_t capacity)\n"
+            "{\n"
+            "    if (capacity <= soa->capacity)\n"
+            "    {\n"
+            "        return 1;\n"
+            "    }\n"
+            "    size_t size = 64;  // Room to align the first array\n", ident, ident);
+    for (int f = 0; f < num_fields; ++f)
+    {
+        meta__sink_printf(sink, "    size += (sizeof(*soa->%s) * capacity + 63) & ~(size_t)63;\n",
+                          def->fields[f].name);
+    }
+    meta__sink_printf(sink,
+            "    char* block = (char*)malloc(size);\n"
+            "    if (!block)\n"
+            "    {\n"
+            "        return 0;\n"
+            "    }\n"
+            "    char* p = (char*)(((uintptr_t)block + 63) & ~(uintptr_t)63);\n");
+    for (int f = 0; f < num_fields; ++f)
+    {
+        const char* name = def->fields[f].name;
+        meta__sink_printf(sink,
+                "    char* %s = p;\n"
+                "    p += (sizeof(*soa->%s) * capacity + 63) & ~(size_t)63;\n"
+                "    if (soa->count)\n"
+                "    {\n"
+                "        memcpy(%s, soa->%s, sizeof(*soa->%s) * soa->count);\n"
+                "    }\n", name, name, name, name, name);
+    }
+    meta__sink_printf(sink, "    free(soa->block);\n    soa->block = block;\n");
+    for (int f = 0; f < num_fields; ++f)
+    {
+        const MetaField* field = &def->fields[f];
+        if (field->array_count)
+        {
+            meta__sink_printf(sink, "    soa->%s = (%s (*)[%d])%s;\n",
+                              field->name, field->type, field->array_count, field->name);
+        }
+        else
+        {
+            meta__sink_printf(sink, "    soa->%s = (%s*)%s;\n", field->name, field->type, field->name);
+        }
+    }
+    meta__sink_printf(sink, "    soa->capacity = capacity;\n    return 1;\n}\n\n");
+
+    // Set
+    meta__sink_printf(sink,
+            "static inline void %sSoA_set(%sSoA* soa, size_t i, const %s* value)\n"
+            "{\n", ident, ident, value_type);
+    for (int f = 0; f < num_fields; ++f)
+    {
+        const char* name = def->fields[f].name;
+        if (def->fields[f].array_count)
+        {
+            meta__sink_printf(sink, "    memcpy(soa->%s[i], value->%s, sizeof(value->%s));\n", name, name, name);
+        }
+        else
+        {
+            meta__sink_printf(sink, "    soa->%s[i] = value->%s;\n", name, name);
+        }
+    }
+    meta__sink_printf(sink, "}\n\n");
+
+    // Get
+    meta__sink_printf(sink,
+            "static inline %s %sSoA_get(const %sSoA* soa, size_t i)\n"
+            "{\n"
+            "    %s value;\n", value_type, ident, ident, value_type);
+    for (int f = 0; f < num_fields; ++f)
+    {
+        const char* name = def->fields[f].name;
+        if (def->fields[f].array_count)
+        {
+            meta__sink_printf(sink, "    memcpy(value.%s, soa->%s[i], sizeof(value.%s));\n", name, name, name);
+        }
+        else
+        {
+            meta__sink_printf(sink, "    value.%s = soa->%s[i];\n", name, name);
+        }
+    }
+    meta__sink_printf(sink, "    return value;\n}\n\n");
+
+    // Push
+    meta__sink_printf(sink,
+            "// Returns the index of the new element, or (size_t)-1 when out of memory.\n"
+            "static inline size_t %sSoA_push(%sSoA* soa, const %s* value)\n"
+            "{\n"
+            "    if (soa->count == soa->capacity &&\n"
+            "        !%sSoA_reserve(soa, soa->capacity ? 2 * soa->capacity : 64))\n"
+            "    {\n"
+            "        return (size_t)-1;\n"
+            "    }\n"
+            "    size_t i = soa->count++;\n"
+            "    %sSoA_set(soa, i, value);\n"
+            "    return i;\n"
+            "}\n\n", ident, ident, value_type, ident, ident);
+
+    // Swap-remove
+    meta__sink_printf(sink,
+            "// Moves the last element into slot i. Doesn't keep the order.\n"
+            "static inline void %sSoA_swap_remove(%sSoA* soa, size_t i)\n"
+            "{\n"
+            "    size_t last = --soa->count;\n"
+            "    if (i != last)\n"
+            "    {\n", ident, ident);
+    for (int f = 0; f < num_fields; ++f)
+    {
+        const char* name = def->fields[f].name;
+        if (def->fields[f].array_count)
+        {
+            meta__sink_printf(sink, "        memcpy(soa->%s[i], soa->%s[last], sizeof(*soa->%s));\n", name, name, name);
+        }
+        else
+        {
+            meta__sink_printf(sink, "        soa->%s[i] = soa->%s[last];\n", name, name);
+        }
+    }
+    meta__sink_printf(sink, "    }\n}\n\n");
+    return 1;
+}
+
+int meta_soa(const char* result_path, const char* source_path, const char* struct_name)
+{
+    MetaStruct* structs = meta_parse_structs(source_path);
+    const MetaStruct* def = meta_find_struct(structs, struct_name);
+    int ok = 0;
+    if (!def)
+    {
+        fprintf(stderr, "Could not find struct %s in %s\n", struct_name, source_path);
+    }
+    else if (!def->is_plain)
+    {
+        fprintf(stderr, "Can't generate SoA for %s: it has nested, bit-field or function pointer members\n",
+                struct_name);
+    }
+    else
+    {
+        MetaSink sink;
+        if (meta_sink_file(&sink, result_path))
+        {
+            ok = meta_soa_sink(&sink, def);
+            meta_sink_close(&sink);
+        }
+    }
+    meta_free_structs(structs);
+    return ok;
+}
+
+// ==== Struct layouts
+
+typedef struct
+{
+    const char* name;
+    uint32_t    size;   // Alignment is the same
+} MetaScalarType;
+
+static const MetaScalarType meta__scalar_types[] =
+{
+    { "_Bool", 1 },     { "bool", 1 },
+    { "int8_t", 1 },    { "uint8_t", 1 },
+    { "int16_t", 2 },   { "uint16_t", 2 },  { "char16_t", 2 },
+    { "int32_t", 4 },   { "uint32_t", 4 },  { "char32_t", 4 },  { "wchar_t", 4 },
+    { "int64_t", 8 },   { "uint64_t", 8 },
+    { "intmax_t", 8 },  { "uintmax_t", 8 },
+    { "size_t", 8 },    { "ssize_t", 8 },   { "ptrdiff_t", 8 },
+    { "intptr_t", 8 },  { "uintptr_t", 8 }, { "off_t", 8 },
+    { "max_align_t", 16 },
+    { "__m64", 8 },
+    { "__m128", 16 },   { "__m128i", 16 },  { "__m128d", 16 },
+    { "__m256", 32 },   { "__m256i", 32 },  { "__m256d", 32 },
+    { "__m512", 64 },   { "__m512i", 64 },  { "__m512d", 64 },
+};
+
+static int meta__struct_size(
+        const MetaStruct* structs,
+        const MetaStruct* def,
+        MetaFieldLayout* fields,
+        uint32_t* size,
+        uint32_t* align,
+        const char** unknown_type,
+        int depth);
+
+// Size and alignment of one element of a field type, e.g. "unsigned long",
+// "const char*" or "struct Foo". Returns 0, with a size and alignment of 0, if
+// it isn't known.
+static int meta__type_size(
+        const MetaStruct* structs,
+        const char* type,
+        uint32_t* size,
+        uint32_t* align,
+        const char** unknown_type,
+        int depth)
+{
+    *size = *align = 0;
+    size_t len = strlen(type);
+    if (len && type[len - 1] == '*')
+    {
+        *size = *align = 8;
+        return 1;
+    }
+
+    // Count the words of builtin types, and keep the one that isn't.
+    int num_long = 0, num_other = 0;
+    int has_char = 0, has_short = 0, has_float = 0, has_double = 0, is_struct = 0, is_enum = 0;
+    const char* other = NULL;
+    size_t other_len = 0;
+    const char* c = type;
+    while (*c)
+    {
+        while (*c == ' ')
+        {
+            ++c;
+        }
+        const char* word = c;
+        while (*c && *c != ' ')
+        {
+            ++c;
+        }
+        size_t word_len = (size_t)(c - word);
+#define META__WORD_IS(str) (word_len == sizeof(str) - 1 && !memcmp(word, str, word_len))
+        if (!word_len || META__WORD_IS("const") || META__WORD_IS("volatile") || META__WORD_IS("restrict") ||
+            META__WORD_IS("signed") || META__WORD_IS("unsigned") || META__WORD_IS("int"))
+        {
+            continue;
+        }
+        else if (META__WORD_IS("long"))     { ++num_long; }
+        else if (META__WORD_IS("char"))     { has_char = 1; }
+        else if (META__WORD_IS("short"))    { has_short = 1; }
+        else if (META__WORD_IS("float"))    { has_float = 1; }
+        else if (META__WORD_IS("double"))   { has_double = 1; }
+        else if (META__WORD_IS("struct"))   { is_struct = 1; }
+        else if (META__WORD_IS("enum"))     { is_enum = 1; }
+        else
+        {
+            other = word;
+            other_len = word_len;
+            ++num_other;
+        }
+#undef META__WORD_IS
+    }
+
+    if (is_enum)
+    {
+        *size = *align = 4;
+        return num_other == 1;
+    }
+    if (num_other == 0)
+    {
+        *size = has_char ? 1 : has_short ? 2 : has_float ? 4 : num_long && has_double ? 16 :
+                has_double || num_long ? 8 : 4;
+        *align = *size;
+        return 1;
+    }
+    if (num_other == 1 && !num_long && !has_char && !has_short && !has_float && !has_double)
+    {
+        if (!is_struct)
+        {
+            for (size_t i = 0; i < sizeof(meta__scalar_types) / sizeof(MetaScalarType); ++i)
+            {
+                const MetaScalarType* scalar = &meta__scalar_types[i];
+                if (strlen(scalar->name) == other_len && !memcmp(scalar->name, other, other_len))
+                {
+                    *size = *align = scalar->size;
+                    return 1;
+                }
+            }
+        }
+        // Structs of the same file, by typedef name or tag. Depth stops
+        // structs that contain each other.
+        for (int i = 0; i < sb_count(structs) && depth < 16; ++i)
+        {
+            const MetaStruct* def = &structs[i];
+            const char* name = is_struct ? def->tag : def->name;
+            if (name && strlen(name) == other_len && !memcmp(name, other, other_len))
+            {
+                return meta__struct_size(structs, def, NULL, size, align, unknown_type, depth + 1);
+            }
+        }
+    }
+    *unknown_type = type;
+    return 0;
+}
+
+// Lays out the fields in `order` (declaration order if NULL). Returns the
+// struct size, and the number of straddling fields in *num_straddling.
+static uint32_t meta__place_fields(
+        MetaFieldLayout* fields,
+        int num_fields,
+        const int* order,
+        uint32_t align,
+        int* num_straddling)
+{
+    uint32_t offset = 0;
+    MetaFieldLayout* previous = NULL;
+    *num_straddling = 0;
+    for (int i = 0; i < num_fields; ++i)
+    {
+        MetaFieldLayout* field = &fields[order ? order[i] : i];
+        uint32_t aligned = (offset + field->align - 1) & ~(field->align - 1);
+        if (previous)
+        {
+            previous->padding = aligned - offset;
+        }
+        field->offset = aligned;
+        field->straddles = field->size <= 64 && field->size &&
+                           aligned / 64 != (aligned + field->size - 1) / 64;
+        *num_straddling += field->straddles;
+        offset = aligned + field->size;
+        previous = field;
+    }
+    uint32_t size = (offset + align - 1) & ~(align - 1);
+    if (previous)
+    {
+        previous->padding = size - offset;
+    }
+    return size;
+}
+
+// Fills `fields` (may be NULL) in declaration order and returns 1, or returns
+// 0 with the type it couldn't size.
+static int meta__struct_size(
+        const MetaStruct* structs,
+        const MetaStruct* def,
+        MetaFieldLayout* fields,
+        uint32_t* size,
+        uint32_t* align,
+        const char** unknown_type,
+        int depth)
+{
+    if (!def->is_plain || !sb_count(def->fields))
+    {
+        return 0;
+    }
+    int num_fields = sb_count(def->fields);
+    MetaFieldLayout* placed = fields ? fields : (MetaFieldLayout*)calloc(num_fields, sizeof(MetaFieldLayout));
+    assert(placed);
+    int ok = 1;
+    *align = 1;
+    for (int f = 0; f < num_fields && ok; ++f)
+    {
+        const MetaField* field = &def->fields[f];
+        uint32_t field_size, field_align;
+        ok = meta__type_size(structs, field->type, &field_size, &field_align, unknown_type, depth);
+        placed[f].size = field_size * (field->array_count ? (uint32_t)field->array_count : 1);
+        placed[f].align = field_align;
+        *align = field_align > *align ? field_align : *align;
+    }
+    int num_straddling;
+    *size = ok ? meta__place_fields(placed, num_fields, NULL, *align, &num_straddling) : 0;
+    if (!fields)
+    {
+        free(placed);
+    }
+    return ok;
+}
+
+int meta_struct_layout(const MetaStruct* structs, const MetaStruct* def, MetaStructLayout* layout)
+{
+    memset(layout, 0, sizeof(MetaStructLayout));
+    int num_fields = sb_count(def->fields);
+    if (!def->is_plain || num_fields <= 0)
+    {
+        return 0;
+    }
+    layout->fields = (MetaFieldLayout*)calloc((size_t)num_fields, sizeof(MetaFieldLayout));
+    assert(layout->fields);
+    if (!meta__struct_size(structs, def, layout->fields, &layout->size, &layout->align, &layout->unknown_type, 0))
+    {
+        const char* unknown_type = layout->unknown_type;
+        meta_free_struct_layout(layout);
+        layout->unknown_type = unknown_type;
+        return 0;
+    }
+    for (int f = 0; f < num_fields; ++f)
+    {
+        layout->padding += layout->fields[f].padding;
+        layout->num_straddling += layout->fields[f].straddles;
+    }
+
+    // Decreasing alignment, declaration order among the same alignment.
+    int* sorted = (int*)malloc((size_t)num_fields * sizeof(int));
+    int* order = (int*)malloc((size_t)num_fields * sizeof(int));
+    assert(sorted && order);
+    for (int f = 0; f < num_fields; ++f)
+    {
+        int i = f;
+        for (; i > 0 && layout->fields[sorted[i - 1]].align < layout->fields[f].align; --i)
+        {
+            sorted[i] = sorted[i - 1];
+        }
+        sorted[i] = f;
+    }
+    // Every field before has at least this alignment and a size that is a
+    // multiple of it, so any field of the largest alignment left fits with no
+    // hole. Take the first one that doesn't cross a line.
+    uint32_t offset = 0;
+    for (int i = 0; i < num_fields; ++i)
+    {
+        int pick = i;
+        for (int j = i; j < num_fields && layout->fields[sorted[j]].align == layout->fields[sorted[i]].align; ++j)
+        {
+            uint32_t field_size = layout->fields[sorted[j]].size;
+            if (field_size > 64 || offset / 64 == (offset + field_size - 1) / 64)
+            {
+                pick = j;
+                break;
+            }
+        }
+        int picked = sorted[pick];
+        memmove(sorted + i + 1, sorted + i, (pick - i) * sizeof(int));
+        sorted[i] = picked;
+        order[i] = picked;
+        offset += layout->fields[picked].size;
+    }
+    free(sorted);
+
+    MetaFieldLayout* suggested = (MetaFieldLayout*)malloc(num_fields * sizeof(MetaFieldLayout));
+    assert(suggested);
+    memcpy(suggested, layout->fields, num_fields * sizeof(MetaFieldLayout));
+    layout->suggested_size = meta__place_fields(suggested, num_fields, order, layout->align,
+                                                &layout->suggested_straddling);
+    free(suggested);
+    if (layout->suggested_size < layout->size ||
+        (layout->suggested_size == layout->size && layout->suggested_straddling < layout->num_straddling))
+    {
+        layout->order = order;
+    }
+    else
+    {
+        free(order);
+        layout->suggested_size = layout->size;
+        layout->suggested_straddling = layout->num_straddling;
+    }
+    return 1;
+}
+
+void meta_free_struct_layout(MetaStructLayout* layout)
+{
+    free(layout->fields);
+    free(layout->order);
+    memset(layout, 0, sizeof(MetaStructLayout));
+}
+
+// Checks of sizeof and offsetof, only for the target the numbers are for.
+static void meta__sink_layout_asserts(MetaSink* sink, const MetaStruct* def, const MetaStructLayout* layout)
+{
+    const char* ident = meta__struct_ident(def);
+    meta__sink_printf(sink, "#if defined(__x86_64__) && !defined(_WIN32)\n");
+    meta__sink_printf(sink, "_Static_assert(sizeof(%s) == %u, \"%s: size changed\");\n",
+                      def->name, layout->size, ident);
+    for (int f = 0; f < sb_count(def->fields); ++f)
+    {
+        const char* name = def->fields[f].name;
+        meta__sink_printf(sink, "_Static_assert(offsetof(%s, %s) == %u, \"%s: %s moved\");\n",
+                          def->name, name, layout->fields[f].offset, ident, name);
+    }
+    meta__sink_printf(sink, "#endif\n");
+}
+
+void meta_struct_layout_sink(MetaSink* sink, const MetaStruct* structs)
+{
+    meta__sink_printf(sink, "// Struct layouts on x86-64 System V.\n\n#include <stddef.h>\n\n");
+    for (int s = 0; s < sb_count(structs); ++s)
+    {
+        const MetaStruct* def = &structs[s];
+        MetaStructLayout layout;
+        if (!meta_struct_layout(structs, def, &layout))
+        {
+            if (layout.unknown_type)
+            {
+                meta__sink_printf(sink, "// %s: unknown size, it has a field of type %s\n\n",
+                                  def->name, layout.unknown_type);
+            }
+            else
+            {
+                meta__sink_printf(sink, "// %s: not laid out, it has nested, bit-field or function pointer members\n\n",
+                                  def->name);
+            }
+            continue;
+        }
+
+        int num_fields = sb_count(def->fields);
+        meta__sink_printf(sink, "// %s: %u bytes, align %u, %u bytes of padding", def->name,
+                          layout.size, layout.align, layout.padding);
+        if (layout.num_straddling)
+        {
+            meta__sink_printf(sink, ", %d field%s straddling cache lines", layout.num_straddling,
+                              layout.num_straddling == 1 ? "" : "s");
+        }
+        meta__sink_printf(sink, "\n//     offset   size  align  field\n");
+        for (int f = 0; f < num_fields; ++f)
+        {
+            const MetaFieldLayout* field = &layout.fields[f];
+            meta__sink_printf(sink, "// %10u %6u %6u  %s%s\n", field->offset, field->size, field->align,
+                              def->fields[f].name, field->straddles ? "  (straddles a cache line)" : "");
+            if (field->padding)
+            {
+                meta__sink_printf(sink, "// %10u %6u         (padding)\n", field->offset + field->size, field->padding);
+            }
+        }
+        if (layout.order)
+        {
+            meta__sink_printf(sink, "// Suggested order, %u bytes", layout.suggested_size);
+            if (layout.suggested_size < layout.size)
+            {
+                meta__sink_printf(sink, " (%u less)", layout.size - layout.suggested_size);
+            }
+            meta__sink_printf(sink, ", %d straddling:", layout.suggested_straddling);
+            for (int f = 0; f < num_fields; ++f)
+            {
+                meta__sink_printf(sink, "%s %s", f ? "," : "", def->fields[layout.order[f]].name);
+            }
+            meta__sink_printf(sink, "\n");
+        }
+
+        meta__sink_layout_asserts(sink, def, &layout);
+        meta__sink_printf(sink, "\n");
+        meta_free_struct_layout(&layout);
+    }
+}
+
+int meta_struct_layout_report(const char* result_path, const char* source_path)
+{
+    MetaStruct* structs = meta_parse_structs(source_path);
+    if (!structs)
+    {
+        return 0;
+    }
+    MetaSink sink;
+    int ok = meta_sink_file(&sink, result_path);
+    if (ok)
+    {
+        meta_struct_layout_sink(&sink, structs);
+        meta_sink_close(&sink);
+    }
+    meta_free_structs(structs);
+    return ok;
+}
+
+// ==== Binary serialization
+
+#define META_SERIAL_HEADER_SIZE 32
+
+// Returns 1 if the struct has no pointers, in its fields or in the structs
+// it contains. Other types are left to meta_struct_layout.
+static int meta__struct_is_flat(const MetaStruct* structs, const MetaStruct* def, int depth)
+{
+    for (int f = 0; f < sb_count(def->fields); ++f)
+    {
+        const char* type = def->fields[f].type;
+        size_t len = strlen(type);
+        if (len && type[len - 1] == '*')
+        {
+            return 0;
+        }
+        const char* name = !strncmp(type, "struct ", 7) ? type + 7 : type;
+        for (int i = 0; i < sb_count(structs) && depth < 16; ++i)
+        {
+            const char* other = !strncmp(type, "struct ", 7) ? structs[i].tag : structs[i].name;
+            if (other && !strcmp(other, name) && !meta__struct_is_flat(structs, &structs[i], depth + 1))
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Appends the fields to the schema, nested structs included, so that a
+// change in a member struct changes the hash too.
+static void meta__serial_schema(
+        MetaSink* schema,
+        const MetaStruct* structs,
+        const MetaStruct* def,
+        uint32_t base,
+        int depth)
+{
+    MetaStructLayout layout;
+    if (!meta_struct_layout(structs, def, &layout))
+    {
+        return;
+    }
+    meta__sink_printf(schema, "%s %u %u {", def->name, layout.size, layout.align);
+    for (int f = 0; f < sb_count(def->fields); ++f)
+    {
+        const MetaField* field = &def->fields[f];
+        meta__sink_printf(schema, " %s %s[%d] %u %u;", field->type, field->name, field->array_count,
+                          base + layout.fields[f].offset, layout.fields[f].size);
+        const char* name = !strncmp(field->type, "struct ", 7) ? field->type + 7 : field->type;
+        for (int i = 0; i < sb_count(structs) && depth < 16; ++i)
+        {
+            const char* other = !strncmp(field->type, "struct ", 7) ? structs[i].tag : structs[i].name;
+            if (other && !strcmp(other, name))
+            {
+                meta__serial_schema(schema, structs, &structs[i], base + layout.fields[f].offset, depth + 1);
+            }
+        }
+    }
+    meta__sink_printf(schema, " }");
+    meta_free_struct_layout(&layout);
+}
+
+// The struct a field of this type is, or NULL if it isn't one of `structs`.
+static const MetaStruct* meta__serial_find_struct(const MetaStruct* structs, const char* type)
+{
+    const char* name = !strncmp(type, "struct ", 7) ? type + 7 : type;
+    for (int i = 0; i < sb_count(structs); ++i)
+    {
+        const char* other = !strncmp(type, "struct ", 7) ? structs[i].tag : structs[i].name;
+        if (other && !strcmp(other, name))
+        {
+            return &structs[i];
+        }
+    }
+    return NULL;
+}
+
+// Sum of the sizes of the fields, nested structs broken down into theirs, as a
+// C expression. It equals sizeof the struct only if there are no holes.
+static void meta__serial_field_bytes(MetaSink* sink, const MetaStruct* structs, const MetaStruct* def, int depth)
+{
+    meta__sink_printf(sink, "(");
+    for (int f = 0; f < sb_count(def->fields); ++f)
+    {
+        const char* name = def->fields[f].name;
+        const MetaStruct* inner = depth < 16 ? meta__serial_find_struct(structs, def->fields[f].type) : NULL;
+        meta__sink_printf(sink, "%ssizeof(((%s*)0)->%s)", f ? " + " : "", def->name, name);
+        if (inner)
+        {
+            meta__sink_printf(sink, " / sizeof(%s) * ", inner->name);
+            meta__serial_field_bytes(sink, structs, inner, depth + 1);
+        }
+    }
+    meta__sink_printf(sink, ")");
+}
+
+// Copies every field of `in` (an access prefix, e.g. "values[i].") to `out`.
+// Nested structs are copied field by field as well, so none of their padding
+// is copied either.
+static void meta__serial_copy_fields(
+        MetaSink* sink,
+        const MetaStruct* structs,
+        const MetaStruct* def,
+        const char* out,
+        const char* in,
+        int depth,
+        int indent)
+{
+    for (int f = 0; f < sb_count(def->fields); ++f)
+    {
+        const char* name = def->fields[f].name;
+        const MetaStruct* inner = depth < 16 ? meta__serial_find_struct(structs, def->fields[f].type) : NULL;
+        if (!inner)
+        {
+            meta__sink_printf(sink, "%*smemcpy(%s + offsetof(%s, %s), &%s%s, sizeof(%s%s));\n",
+                              indent, "", out, def->name, name, in, name, in, name);
+            continue;
+        }
+        // One element, or an array of them.
+        meta__sink_printf(sink,
+                "%*sfor (size_t j%d = 0; j%d < sizeof(%s%s) / sizeof(%s); ++j%d)\n"
+                "%*s{\n"
+                "%*s    unsigned char* out%d = %s + offsetof(%s, %s) + j%d * sizeof(%s);\n"
+                "%*s    const %s* in%d = (const %s*)&%s%s + j%d;\n",
+                indent, "", depth, depth, in, name, inner->name, depth,
+                indent, "",
+                indent, "", depth, out, def->name, name, depth, inner->name,
+                indent, "", inner->name, depth, inner->name, in, name, depth);
+        char inner_out[16];
+        char inner_in[16];
+        snprintf(inner_out, sizeof(inner_out), "out%d", depth);
+        snprintf(inner_in, sizeof(inner_in), "in%d->", depth);
+        meta__serial_copy_fields(sink, structs, inner, inner_out, inner_in, depth + 1, indent + 4);
+        meta__sink_printf(sink, "%*s}\n", indent, "");
+    }
+}
+
+int meta_serial_sink(MetaSink* sink, const MetaStruct* structs, const MetaStruct* def)
+{
+    MetaStructLayout layout;
+    if (!def || !meta__struct_is_flat(structs, def, 0) || !meta_struct_layout(structs, def, &layout))
+    {
+        return 0;
+    }
+    const char* type = def->name;
+    const char* ident = meta__struct_ident(def);
+    uint32_t header_size = layout.align > META_SERIAL_HEADER_SIZE ? layout.align : META_SERIAL_HEADER_SIZE;
+
+    MetaSink schema;
+    meta_sink_memory(&schema);
+    meta__serial_schema(&schema, structs, def, 0, 0);
+    uint64_t schema_hash = meta_hash64(schema.data, schema.count);
+    meta_sink_close(&schema);
+
+    meta__sink_printf(sink, "//Serialization: %s\n\n", type);
+    meta__sink_printf(sink, "#include <stddef.h>\n#include <stdint.h>\n#include <string.h>\n\n");
+    meta__sink_printf(sink,
+            "#define %s_SCHEMA 0x%016llxull\n"
+            "#define %s_SERIAL_HEADER_SIZE %u\n"
+            "#define %s_SERIAL_ALIGN %u\n\n",
+            ident, (unsigned long long)schema_hash, ident, header_size, ident, layout.align);
+    // The schema is only right if the compiler lays it out the same way.
+    meta__sink_layout_asserts(sink, def, &layout);
+    meta__sink_printf(sink, "\n");
+
+    meta__sink_printf(sink,
+            "static inline size_t %s_serial_size(size_t count)\n"
+            "{\n"
+            "    return %s_SERIAL_HEADER_SIZE + count * sizeof(%s);\n"
+            "}\n\n", ident, ident, type);
+
+    // Write: the header, then one copy of the whole array if the struct has no
+    // holes. Otherwise zeros, and every field on top, so that no padding byte
+    // of `values` gets into the buffer. Which case it is is decided by the
+    // compiler, from the sizes it uses, not from the layout worked out here.
+    meta__sink_printf(sink,
+            "// `buffer` needs %s_serial_size(count) bytes.\n"
+            "static inline void %s_serial_write(void* buffer, const %s* values, size_t count)\n"
+            "{\n"
+            "    unsigned char* out = (unsigned char*)buffer;\n"
+            "    uint32_t element_size = (uint32_t)sizeof(%s);\n"
+            "    uint64_t schema = %s_SCHEMA;\n"
+            "    uint64_t count64 = (uint64_t)count;\n"
+            "    uint32_t header_size = %s_SERIAL_HEADER_SIZE;\n"
+            "    memset(out, 0, %s_SERIAL_HEADER_SIZE);\n"
+            "    memcpy(out, \"ADCS\", 4);\n"
+            "    memcpy(out + 4, &element_size, 4);\n"
+            "    memcpy(out + 8, &schema, 8);\n"
+            "    memcpy(out + 16, &count64, 8);\n"
+            "    memcpy(out + 24, &header_size, 4);\n"
+            "    if (!count)\n"
+            "    {\n"
+            "        return;\n"
+            "    }\n"
+            "    size_t field_bytes = ", ident, ident, type, type, ident, ident, ident);
+    meta__serial_field_bytes(sink, structs, def, 0);
+    meta__sink_printf(sink, ";\n"
+            "    if (field_bytes == sizeof(%s))\n"
+            "    {\n"
+            "        memcpy(out + %s_SERIAL_HEADER_SIZE, values, count * sizeof(%s));\n"
+            "        return;\n"
+            "    }\n"
+            "    memset(out + %s_SERIAL_HEADER_SIZE, 0, count * sizeof(%s));\n"
+            "    for (size_t i = 0; i < count; ++i)\n"
+            "    {\n"
+            "        unsigned char* element = out + %s_SERIAL_HEADER_SIZE + i * sizeof(%s);\n",
+            type, ident, type, ident, type, ident, type);
+    meta__serial_copy_fields(sink, structs, def, "element", "values[i].", 0, 8);
+    meta__sink_printf(sink, "    }\n");
+    meta__sink_printf(sink, "}\n\n");
+
+    // Count: checks the header.
+    meta__sink_printf(sink,
+            "// Returns the number of elements in a buffer written by %s_serial_write,\n"
+            "// or (size_t)-1 if it is damaged or has another layout.\n"
+            "static inline size_t %s_serial_count(const void* buffer, size_t size)\n"
+            "{\n"
+            "    const unsigned char* in = (const unsigned char*)buffer;\n"
+            "    uint32_t element_size, header_size;\n"
+            "    uint64_t schema, count;\n"
+            "    if (size < %s_SERIAL_HEADER_SIZE || memcmp(in, \"ADCS\", 4))\n"
+            "    {\n"
+            "        return (size_t)-1;\n"
+            "    }\n"
+            "    memcpy(&element_size, in + 4, 4);\n"
+            "    memcpy(&schema, in + 8, 8);\n"
+            "    memcpy(&count, in + 16, 8);\n"
+            "    memcpy(&header_size, in + 24, 4);\n"
+            "    if (element_size != sizeof(%s) || schema != %s_SCHEMA || header_size != %s_SERIAL_HEADER_SIZE ||\n"
+            "        count > (size - %s_SERIAL_HEADER_SIZE) / sizeof(%s))\n"
+            "    {\n"
+            "        return (size_t)-1;\n"
+            "    }\n"
+            "    return (size_t)count;\n"
+            "}\n\n", ident, ident, ident, type, ident, ident, ident, type);
+
+    // View: no copy.
+    meta__sink_printf(sink,
+            "// The elements, in place. NULL if _count fails or the buffer isn't aligned\n"
+            "// for %s; then _read still works.\n"
+            "static inline const %s* %s_serial_view(const void* buffer, size_t size, size_t* count)\n"
+            "{\n"
+            "    size_t n = %s_serial_count(buffer, size);\n"
+            "    const unsigned char* values = (const unsigned char*)buffer + %s_SERIAL_HEADER_SIZE;\n"
+            "    if (n == (size_t)-1 || (uintptr_t)values %% %s_SERIAL_ALIGN)\n"
+            "    {\n"
+            "        return NULL;\n"
+            "    }\n"
+            "    *count = n;\n"
+            "    return (const %s*)values;\n"
+            "}\n\n", type, type, ident, ident, ident, ident, type);
+
+    // Read: one copy.
+    meta__sink_printf(sink,
+            "// Copies up to max_count elements out. Returns how many there are, or\n"
+            "// (size_t)-1 like _count.\n"
+            "static inline size_t %s_serial_read(const void* buffer, size_t size, %s* values, size_t max_count)\n"
+            "{\n"
+            "    size_t n = %s_serial_count(buffer, size);\n"
+            "    if (n != (size_t)-1 && n)\n"
+            "    {\n"
+            "        memcpy(values, (const unsigned char*)buffer + %s_SERIAL_HEADER_SIZE,\n"
+            "               (n < max_count ? n : max_count) * sizeof(%s));\n"
+            "    }\n"
+            "    return n;\n"
+            "}\n\n", ident, type, ident, ident, type);
+
+    meta_free_struct_layout(&layout);
+    return 1;
+}
+
+int meta_serial(const char* result_path, const char* source_path, const char* struct_name)
+{
+    MetaStruct* structs = meta_parse_structs(source_path);
+    int ok = 0;
+    if (struct_name && !meta_find_struct(structs, struct_name))
+    {
+        fprintf(stderr, "Could not find struct %s in %s\n", struct_name, source_path);
+    }
+    else
+    {
+        MetaSink sink;
+        if (meta_sink_file(&sink, result_path))
+        {
+            if (struct_name)
+            {
+                ok = meta_serial_sink(&sink, structs, meta_find_struct(structs, struct_name));
+                if (!ok)
+                {
+                    fprintf(stderr, "Can't serialize %s: it isn't plain, has pointers or a field of unknown size\n",
+                            struct_name);
+                }
+            }
+            else
+            {
+                for (int i = 0; i < sb_count(structs); ++i)
+                {
+                    ok |= meta_serial_sink(&sink, structs, &structs[i]);
+                }
+            }
+            meta_sink_close(&sink);
+        }
+    }
+    meta_free_structs(structs);
+    return ok;
+}
+
+// ==== Enum definitions
+
+// Value of `= ...`, tokens [begin, end): a literal with an optional sign, or
+// an earlier enumerator.
+static int meta__enum_value(
+        const MetaEnum* def,
+        const char* src,
+        const MetaToken* tokens,
+        int begin,
+        int end,
+        long long* value)
+{
+    int negative = 0;
+    if (begin < end && (meta__token_is_punct(src, &tokens[begin], '-') || meta__token_is_punct(src, &tokens[begin], '+')))
+    {
+        negative = meta__token_is_punct(src, &tokens[begin], '-');
+        ++begin;
+    }
+    if (begin + 1 != end)
+    {
+        return 0;
+    }
+    const MetaToken* token = &tokens[begin];
+    if (token->kind == META_TOKEN_NUMBER)
+    {
+        char digits[32];
+        if (token->len >= sizeof(digits))
+        {
+            return 0;
+        }
+        memcpy(digits, src + token->offset, token->len);
+        digits[token->len] = '\0';
+        // Suffixes are where strtoull stops.
+        char* stop = NULL;
+        unsigned long long n = strtoull(digits, &stop, 0);
+        for (; *stop; ++stop)
+        {
+            if (*stop != 'u' && *stop != 'U' && *stop != 'l' && *stop != 'L')
+            {
+                return 0;
+            }
+        }
+        *value = negative ? -(long long)n : (long long)n;
+        return 1;
+    }
+    if (token->kind == META_TOKEN_IDENT)
+    {
+        for (int i = 0; i < sb_count(def->values); ++i)
+        {
+            const char* name = def->values[i].name;
+            if (strlen(name) == token->len && !memcmp(name, src + token->offset, token->len))
+            {
+                *value = negative ? -def->values[i].value : def->values[i].value;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Body tokens (open, close), exclusive.
+static void meta__parse_enum_body(
+        MetaEnum* def,
+        const char* src,
+        const MetaToken* tokens,
+        int num_tokens,
+        int open,
+        int close)
+{
+    long long next = 0;
+    int i = open + 1;
+    while (i < close)
+    {
+        if (tokens[i].kind != META_TOKEN_IDENT)
+        {
+            def->is_plain = 0;  // Directive, or something this parser doesn't know
+            return;
+        }
+        MetaEnumerator enumerator = { 0 };
+        enumerator.name = meta__strndup(src + tokens[i].offset, tokens[i].len);
+        enumerator.value = next;
+
+        int end = i + 1;
+        while (end < close && !meta__token_is_punct(src, &tokens[end], ','))
+        {
+            if (meta__token_is_punct(src, &tokens[end], '(') || meta__token_is_punct(src, &tokens[end], '['))
+            {
+                end = meta__matching_token(src, tokens, num_tokens, end);
+            }
+            else if (tokens[end].kind == META_TOKEN_DIRECTIVE)
+            {
+                def->is_plain = 0;
+            }
+            ++end;
+        }
+        if (end > i + 1)
+        {
+            if (!meta__token_is_punct(src, &tokens[i + 1], '='))
+            {
+                def->is_plain = 0;
+            }
+            else if (def->values_known &&
+                     !meta__enum_value(def, src, tokens, i + 2, end, &enumerator.value))
+            {
+                def->values_known = 0;
             }
-            ent = readdir(dir);
         }
+        next = enumerator.value + 1;
+        sb_push(def->values, enumerator);
+        i = end + 1;
+    }
+}
+
+static MetaEnum* meta__parse_enums_tokens(const char* src, const MetaToken* tokens, int num_tokens)
+{
+    MetaEnum* enums = NULL;
+    int depth = 0;
+    for (int i = 0; i < num_tokens; ++i)
+    {
+        const MetaToken* token = &tokens[i];
+        if (meta__token_is_punct(src, token, '{'))
+        {
+            ++depth;
+        }
+        else if (meta__token_is_punct(src, token, '}'))
+        {
+            --depth;
+        }
+        if (depth != 0 || !meta__token_is(src, token, "enum"))
+        {
+            continue;
+        }
+
+        int is_typedef = i > 0 && meta__token_is(src, &tokens[i - 1], "typedef");
+        int j = i + 1;
+        const MetaToken* tag = NULL;
+        if (j < num_tokens && tokens[j].kind == META_TOKEN_IDENT)
+        {
+            tag = &tokens[j++];
+        }
+        if (j >= num_tokens || !meta__token_is_punct(src, &tokens[j], '{'))
+        {
+            continue;  // `enum Tag x;`
+        }
+        int close = meta__matching_token(src, tokens, num_tokens, j);
+
+        MetaEnum def = { 0 };
+        def.values_known = 1;
+        def.is_plain = 1;
+        if (tag)
+        {
+            def.tag = meta__strndup(src + tag->offset, tag->len);
+        }
+        if (is_typedef && close + 1 < num_tokens && tokens[close + 1].kind == META_TOKEN_IDENT)
+        {
+            def.name = meta__strndup(src + tokens[close + 1].offset, tokens[close + 1].len);
+        }
+        else if (tag)
+        {
+            def.name = (char*)malloc(tag->len + 6);
+            assert(def.name);
+            memcpy(def.name, "enum ", 5);
+            memcpy(def.name + 5, src + tag->offset, tag->len);
+            def.name[tag->len + 5] = '\0';
+        }
+
+        if (def.name)
+        {
+            meta__parse_enum_body(&def, src, tokens, num_tokens, j, close);
+            sb_push(enums, def);
+        }
+        else
+        {
+            free(def.tag);
+        }
+        i = close;
+    }
+    return enums;
+}
 
-        closedir(dir);
+MetaEnum* meta_parse_enums(const char* path)
+{
+    MetaMappedFile mapped;
+    if (!meta_map_file(path, &mapped))
+    {
+        fprintf(stderr, "Could not open file for processing, %s\n", path);
+        return NULL;
     }
-    // Do output!
+    MetaToken* tokens = meta_lex_c(mapped.data, mapped.size);
+    MetaEnum* enums = meta__parse_enums_tokens(mapped.data, tokens, sb_count(tokens));
+    meta_free_tokens(tokens);
+    meta_unmap_file(&mapped);
+    return enums;
+}
+
+const MetaEnum* meta_find_enum(const MetaEnum* enums, const char* name)
+{
+    for (int i = 0; i < sb_count(enums); ++i)
     {
-        int debug_limit = 40;
-        int begin = 0;
-        int end = 0;
-        while (end < array_count(type_decls))
+        const MetaEnum* def = &enums[i];
+        if (!strcmp(def->name, name) || (def->tag && !strcmp(def->tag, name)))
         {
-            // Move end to next 0
-            while (type_decls[++end] != 0);
-            char* var_name = type_decls[begin];
-            char* func_name = type_decls[end - 1];
-            int is_valid = 1;
-            char** type = 0;
-            for (int i = begin + 1; i < end - 1; ++i)
+            return def;
+        }
+    }
+    return NULL;
+}
+
+void meta_free_enums(MetaEnum* enums)
+{
+    for (int i = 0; i < sb_count(enums); ++i)
+    {
+        MetaEnum* def = &enums[i];
+        for (int v = 0; v < sb_count(def->values); ++v)
+        {
+            free(def->values[v].name);
+        }
+        meta__sb_free(def->values);
+        free(def->name);
+        free(def->tag);
+    }
+    meta__sb_free(enums);
+}
+
+// ==== Perfect hash lookups
+
+// Seeds tried per bucket before giving up on a salt.
+#define META_PERFECT_HASH_MAX_SEED (1u << 24)
+#define META_PERFECT_HASH_MAX_SALT 64
+
+// The generated lookup repeats these two, character for character.
+static uint32_t meta__perfect_hash_mix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint32_t meta__perfect_hash_key(const char* str, size_t len, uint32_t salt)
+{
+    uint32_t h = 2166136261u ^ salt;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+    return meta__perfect_hash_mix(h);
+}
+
+typedef struct
+{
+    uint32_t    salt;
+    int         num_buckets;
+    uint32_t*   seeds;      // One per bucket
+    int*        slots;      // String index per slot
+} PerfectHash;
+
+typedef struct
+{
+    uint32_t    key;        // Hash or bucket size
+    int         index;
+} PerfectHashSortEntry;
+
+static int meta__perfect_hash_cmp(const void* a, const void* b)
+{
+    const PerfectHashSortEntry* ea = (const PerfectHashSortEntry*)a;
+    const PerfectHashSortEntry* eb = (const PerfectHashSortEntry*)b;
+    if (ea->key != eb->key)
+    {
+        return ea->key < eb->key ? -1 : 1;
+    }
+    return ea->index - eb->index;
+}
+
+// Returns 0 if two strings are the same, or no salt works.
+static int meta__perfect_hash_build(const char* const* strings, int num_strings, PerfectHash* ph)
+{
+    int n = num_strings;
+    int num_buckets = n / 2 + 1;
+    uint32_t* hashes = (uint32_t*)malloc(n * sizeof(uint32_t));
+    PerfectHashSortEntry* sorted = (PerfectHashSortEntry*)malloc(n * sizeof(PerfectHashSortEntry));
+    PerfectHashSortEntry* buckets = (PerfectHashSortEntry*)malloc(num_buckets * sizeof(PerfectHashSortEntry));
+    int* bucket_start = (int*)malloc((num_buckets + 1) * sizeof(int));
+    int* members = (int*)malloc(n * sizeof(int));
+    int* trial = (int*)malloc(n * sizeof(int));
+    char* taken = (char*)malloc(n);
+    ph->seeds = (uint32_t*)malloc(num_buckets * sizeof(uint32_t));
+    ph->slots = (int*)malloc(n * sizeof(int));
+    ph->num_buckets = num_buckets;
+    assert(hashes && sorted && buckets && bucket_start && members && trial && taken && ph->seeds && ph->slots);
+
+    int found = 0;
+    int duplicate = 0;
+    for (uint32_t salt = 0; salt < META_PERFECT_HASH_MAX_SALT && !found && !duplicate; ++salt)
+    {
+        // Strings with the same full hash can't be told apart by any seed.
+        int collision = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            hashes[i] = meta__perfect_hash_key(strings[i], strlen(strings[i]), salt);
+            sorted[i].key = hashes[i];
+            sorted[i].index = i;
+        }
+        qsort(sorted, n, sizeof(sorted[0]), meta__perfect_hash_cmp);
+        for (int i = 1; i < n && !duplicate; ++i)
+        {
+            if (sorted[i].key == sorted[i - 1].key)
+            {
+                collision = 1;
+                if (!strcmp(strings[sorted[i].index], strings[sorted[i - 1].index]))
+                {
+                    fprintf(stderr, "Perfect hash: \"%s\" is in the set twice\n", strings[sorted[i].index]);
+                    duplicate = 1;
+                }
+            }
+        }
+        if (collision)
+        {
+            continue;
+        }
+
+        // Strings grouped by bucket, then the buckets from biggest to smallest.
+        memset(bucket_start, 0, (num_buckets + 1) * sizeof(int));
+        for (int i = 0; i < n; ++i)
+        {
+            ++bucket_start[hashes[i] % num_buckets + 1];
+        }
+        for (int b = 0; b < num_buckets; ++b)
+        {
+            buckets[b].key = (uint32_t)(n - bucket_start[b + 1]);
+            buckets[b].index = b;
+            bucket_start[b + 1] += bucket_start[b];
+        }
+        for (int i = 0; i < n; ++i)
+        {
+            trial[i] = 0;
+        }
+        for (int i = 0; i < n; ++i)
+        {
+            int b = hashes[i] % num_buckets;
+            members[bucket_start[b] + trial[b]++] = i;
+        }
+        qsort(buckets, num_buckets, sizeof(buckets[0]), meta__perfect_hash_cmp);
+
+        memset(taken, 0, n);
+        memset(ph->seeds, 0, num_buckets * sizeof(uint32_t));
+        found = 1;
+        for (int k = 0; k < num_buckets && found; ++k)
+        {
+            int b = buckets[k].index;
+            int begin = bucket_start[b];
+            int count = bucket_start[b + 1] - begin;
+            if (!count)
+            {
+                break;  // The rest are empty too
+            }
+            uint32_t seed = 0;
+            for (; seed < META_PERFECT_HASH_MAX_SEED; ++seed)
             {
-                char* type = type_decls[i];
-                int is_type = 0;
-                for (int j = 0; j < array_count(known_types); ++j)
+                int placed = 0;
+                for (; placed < count; ++placed)
                 {
-                    if (!strcmp(type, known_types[j]))
+                    int slot = (int)(meta__perfect_hash_mix(hashes[members[begin + placed]] ^ seed) % (uint32_t)n);
+                    if (taken[slot])
                     {
-                        is_type = 1;
                         break;
                     }
+                    taken[slot] = 1;
+                    trial[placed] = slot;
                 }
-                if (!is_type)
+                if (placed == count)
                 {
-                    is_valid = 0;
                     break;
                 }
+                for (int m = 0; m < placed; ++m)
+                {
+                    taken[trial[m]] = 0;
+                }
             }
-            // We had to go through the loop
-            if (end - begin < 3)
+            if (seed == META_PERFECT_HASH_MAX_SEED)
             {
-                is_valid = 0;
+                found = 0;
+                break;
             }
-            if (is_valid)
+            ph->seeds[b] = seed;
+            for (int m = 0; m < count; ++m)
             {
-                puts("==== Valid type");
-                puts(func_name);
-                char identifier[1024] = { 0 };
-                char type_str[1024] = { 0 };
-                sprintf((char*)identifier, "ADC_TYPE__FUNC__%s__NAME__%s",
-                                func_name, var_name);
-                for (int i = end - 2; i >= begin + 1; --i)
+                ph->slots[trial[m]] = members[begin + m];
+            }
+        }
+        ph->salt = salt;
+    }
+    if (!found && !duplicate)
+    {
+        fprintf(stderr, "Perfect hash: no seeds found for %d strings\n", n);
+    }
+
+    free(hashes);
+    free(sorted);
+    free(buckets);
+    free(bucket_start);
+    free(members);
+    free(trial);
+    free(taken);
+    if (!found)
+    {
+        free(ph->seeds);
+        free(ph->slots);
+        ph->seeds = NULL;
+        ph->slots = NULL;
+    }
+    return found;
+}
+
+// Smallest unsigned type that holds max.
+static const char* meta__uint_type(uint32_t max)
+{
+    return max <= 0xff ? "uint8_t" : max <= 0xffff ? "uint16_t" : "uint32_t";
+}
+
+static void meta__sink_c_string(MetaSink* sink, const char* str)
+{
+    meta_sink_write(sink, "\"", 1);
+    for (const char* c = str; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            meta_sink_write(sink, "\\", 1);
+            meta_sink_write(sink, c, 1);
+        }
+        else if ((unsigned char)*c < ' ' || (unsigned char)*c >= 0x7f)
+        {
+            meta__sink_printf(sink, "\\%03o", (unsigned char)*c);
+        }
+        else
+        {
+            meta_sink_write(sink, c, 1);
+        }
+    }
+    meta_sink_write(sink, "\"", 1);
+}
+
+static void meta__sink_uint_array(MetaSink* sink, const char* type, const char* name, const uint32_t* values, int count)
+{
+    meta__sink_printf(sink, "static const %s %s[%d] =\n{", type, name, count);
+    for (int i = 0; i < count; ++i)
+    {
+        meta__sink_printf(sink, "%s%u,", i % 12 ? " " : "\n    ", values[i]);
+    }
+    meta__sink_printf(sink, "\n};\n\n");
+}
+
+int meta_perfect_hash_sink(MetaSink* sink, const char* name, const char* const* strings, int num_strings)
+{
+    PerfectHash ph = { 0 };
+    if (num_strings <= 0 || !meta__perfect_hash_build(strings, num_strings, &ph))
+    {
+        return 0;
+    }
+    int n = num_strings;
+
+    meta__sink_printf(sink, "//Perfect hash: %s, %d strings\n\n", name, n);
+    meta__sink_printf(sink, "#include <stddef.h>\n#include <stdint.h>\n#include <string.h>\n\n");
+    meta__sink_printf(sink, "#define %s_COUNT %d\n\n", name, n);
+
+    meta__sink_printf(sink, "static const char* const %s_strings[%d] =\n{\n", name, n);
+    uint32_t max_len = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        meta__sink_printf(sink, "    ");
+        meta__sink_c_string(sink, strings[i]);
+        meta__sink_printf(sink, ",\n");
+        uint32_t len = (uint32_t)strlen(strings[i]);
+        max_len = len > max_len ? len : max_len;
+    }
+    meta__sink_printf(sink, "};\n\n");
+
+    uint32_t* values = (uint32_t*)malloc((n > ph.num_buckets ? n : ph.num_buckets) * sizeof(uint32_t));
+    assert(values);
+    char array_name[256];
+    for (int i = 0; i < n; ++i)
+    {
+        values[i] = (uint32_t)strlen(strings[i]);
+    }
+    snprintf(array_name, sizeof(array_name), "%s_lengths", name);
+    meta__sink_uint_array(sink, meta__uint_type(max_len), array_name, values, n);
+
+    uint32_t max_seed = 0;
+    for (int b = 0; b < ph.num_buckets; ++b)
+    {
+        values[b] = ph.seeds[b];
+        max_seed = ph.seeds[b] > max_seed ? ph.seeds[b] : max_seed;
+    }
+    snprintf(array_name, sizeof(array_name), "%s_seeds", name);
+    meta__sink_uint_array(sink, meta__uint_type(max_seed), array_name, values, ph.num_buckets);
+
+    for (int i = 0; i < n; ++i)
+    {
+        values[i] = (uint32_t)ph.slots[i];
+    }
+    snprintf(array_name, sizeof(array_name), "%s_slots", name);
+    meta__sink_uint_array(sink, meta__uint_type((uint32_t)n - 1), array_name, values, n);
+    free(values);
+
+    meta__sink_printf(sink,
+            "static inline uint32_t %s_mix(uint32_t h)\n"
+            "{\n"
+            "    h ^= h >> 16;\n"
+            "    h *= 0x85ebca6bu;\n"
+            "    h ^= h >> 13;\n"
+            "    h *= 0xc2b2ae35u;\n"
+            "    h ^= h >> 16;\n"
+            "    return h;\n"
+            "}\n\n", name);
+    meta__sink_printf(sink,
+            "// Returns the index of str in %s_strings, or -1 if it isn't one of them.\n"
+            "static inline int %s_lookup(const char* str, size_t len)\n"
+            "{\n"
+            "    uint32_t h = 2166136261u ^ %uu;\n"
+            "    for (size_t i = 0; i < len; ++i)\n"
+            "    {\n"
+            "        h ^= (unsigned char)str[i];\n"
+            "        h *= 16777619u;\n"
+            "    }\n"
+            "    h = %s_mix(h);\n"
+            "    int i = (int)%s_slots[%s_mix(h ^ %s_seeds[h %% %uu]) %% %uu];\n"
+            "    return (len == %s_lengths[i] && !memcmp(str, %s_strings[i], len)) ? i : -1;\n"
+            "}\n\n",
+            name, name, ph.salt, name, name, name, name, (unsigned)ph.num_buckets, (unsigned)n, name, name);
+
+    free(ph.seeds);
+    free(ph.slots);
+    return 1;
+}
+
+int meta_perfect_hash(const char* result_path, const char* name, const char* const* strings, int num_strings)
+{
+    MetaSink sink;
+    if (!meta_sink_file(&sink, result_path))
+    {
+        return 0;
+    }
+    int ok = meta_perfect_hash_sink(&sink, name, strings, num_strings);
+    meta_sink_close(&sink);
+    return ok;
+}
+
+int meta_enum_strings_sink(MetaSink* sink, const MetaEnum* def)
+{
+    if (!def || !def->is_plain || !sb_count(def->values))
+    {
+        return 0;
+    }
+    const char* type = def->name;
+    const char* ident = strncmp(def->name, "enum ", 5) ? def->name : def->tag;
+    int n = sb_count(def->values);
+
+    const char** names = (const char**)calloc(n, sizeof(const char*));
+    assert(names);
+    for (int i = 0; i < n; ++i)
+    {
+        names[i] = def->values[i].name;
+    }
+    int ok = meta_perfect_hash_sink(sink, ident, names, n);
+    free(names);
+    if (!ok)
+    {
+        return 0;
+    }
+
+    meta__sink_printf(sink, "static const %s %s_values[%d] =\n{\n", type, ident, n);
+    for (int i = 0; i < n; ++i)
+    {
+        meta__sink_printf(sink, "    %s,\n", def->values[i].name);
+    }
+    meta__sink_printf(sink, "};\n\n");
+
+    int contiguous = def->values_known;
+    for (int i = 0; i < n && contiguous; ++i)
+    {
+        contiguous = def->values[i].value == i;
+    }
+    meta__sink_printf(sink,
+            "// NULL if value isn't one of the enumerators.\n"
+            "static inline const char* %s_to_string(%s value)\n"
+            "{\n", ident, type);
+    if (contiguous)
+    {
+        meta__sink_printf(sink,
+                "    return (unsigned long long)value < %du ? %s_strings[(int)value] : NULL;\n",
+                n, ident);
+    }
+    else if (def->values_known)
+    {
+        meta__sink_printf(sink, "    switch (value)\n    {\n");
+        for (int i = 0; i < n; ++i)
+        {
+            int alias = 0;
+            for (int j = 0; j < i && !alias; ++j)
+            {
+                alias = def->values[j].value == def->values[i].value;
+            }
+            if (!alias)
+            {
+                meta__sink_printf(sink, "        case %s: return %s_strings[%d];\n", def->values[i].name, ident, i);
+            }
+        }
+        meta__sink_printf(sink, "        default: return NULL;\n    }\n");
+    }
+    else
+    {
+        // Values the parser couldn't work out, so no switch: aliases would be
+        // duplicate cases.
+        meta__sink_printf(sink,
+                "    for (int i = 0; i < %d; ++i)\n"
+                "    {\n"
+                "        if (%s_values[i] == value)\n"
+                "        {\n"
+                "            return %s_strings[i];\n"
+                "        }\n"
+                "    }\n"
+                "    return NULL;\n", n, ident, ident);
+    }
+    meta__sink_printf(sink, "}\n\n");
+
+    meta__sink_printf(sink,
+            "// Returns 0 and leaves value alone if str isn't the name of an enumerator.\n"
+            "static inline int %s_from_string(const char* str, size_t len, %s* value)\n"
+            "{\n"
+            "    int i = %s_lookup(str, len);\n"
+            "    if (i < 0)\n"
+            "    {\n"
+            "        return 0;\n"
+            "    }\n"
+            "    *value = %s_values[i];\n"
+            "    return 1;\n"
+            "}\n\n", ident, type, ident, ident);
+    return 1;
+}
+
+int meta_enum_strings(const char* result_path, const char* source_path, const char* enum_name)
+{
+    MetaEnum* enums = meta_parse_enums(source_path);
+    int ok = 0;
+    if (enum_name && !meta_find_enum(enums, enum_name))
+    {
+        fprintf(stderr, "Could not find enum %s in %s\n", enum_name, source_path);
+    }
+    else
+    {
+        MetaSink sink;
+        if (meta_sink_file(&sink, result_path))
+        {
+            if (enum_name)
+            {
+                ok = meta_enum_strings_sink(&sink, meta_find_enum(enums, enum_name));
+                if (!ok)
                 {
-                    char* type = type_decls[i];
-                    int is_qualifier = 0;
-                    // Filter type qualifiers (const static volatile)
-                    static const char* qualifiers[] =
-                    {
-                        "static", "const", "volatile", "auto",
-                    };
-                    {
-                        for (int j = 0; j < sizeof(qualifiers) / sizeof(char*); ++j)
-                        {
-                            if (!strcmp(type, qualifiers[j]))
-                            {
-                                is_qualifier = 1;
-                            }
-                        }
-                    }
-                    if (!is_qualifier)
-                    {
-                        sprintf((char*)type_str, "%s %s ", type_str, type);
-                        puts(type);
-                    }
+                    fprintf(stderr, "Can't make strings for %s: it has directives or syntax this parser doesn't know\n",
+                            enum_name);
                 }
-                puts(var_name);
-                char* header_line[1024];
-                sprintf((char*)header_line, "#ifndef %s\n#define %s %s\n#endif\n",
-                        identifier, identifier, type_str);
-                fwrite((const char*)header_line, sizeof(char), strlen((char*)header_line), fd);
-
             }
-            begin = end + 1;
+            else
+            {
+                for (int i = 0; i < sb_count(enums); ++i)
+                {
+                    ok |= meta_enum_strings_sink(&sink, &enums[i]);
+                }
+            }
+            meta_sink_close(&sink);
+        }
+    }
+    meta_free_enums(enums);
+    return ok;
+}
+
+// ==== Embedding templates
+
+static const char* meta__segment_kind_names[] =
+{
+    "META_SEGMENT_LITERAL",
+    "META_SEGMENT_SLOT",
+    "META_SEGMENT_REPEAT",
+    "META_SEGMENT_END",
+};
+
+static void meta__embed_template(MetaSink* sink, const MetaTemplate* tmpl, int index)
+{
+    meta__sink_printf(sink, "// %s\n", tmpl->path);
+
+    // A byte array rather than a string literal: MSVC limits string literals to 64 KB.
+    meta__sink_printf(sink, "static const char meta__embedded_%d_source[] =\n{", index);
+    for (size_t i = 0; i < tmpl->source_len; ++i)
+    {
+        meta__sink_printf(sink, "%s0x%02x,", i % 16 ? " " : "\n    ", (uint8_t)tmpl->source[i]);
+    }
+    // NUL-terminated, so that empty templates still have an element.
+    meta__sink_printf(sink, "%s0x00\n};\n\n", tmpl->source_len % 16 ? " " : "\n    ");
+
+    meta__sink_printf(sink, "static MetaSegment meta__embedded_%d_segments[] =\n{\n", index);
+    for (int i = 0; i < tmpl->num_segments; ++i)
+    {
+        const MetaSegment* segment = &tmpl->segments[i];
+        meta__sink_printf(sink, "    { %s, %lu, %lu, 0x%08xu, %d },\n",
+                          meta__segment_kind_names[segment->kind],
+                          (unsigned long)segment->offset, (unsigned long)segment->len,
+                          segment->hash, segment->end);
+    }
+    if (!tmpl->num_segments)
+    {
+        meta__sink_printf(sink, "    { 0 },\n");
+    }
+    meta__sink_printf(sink, "};\n\n");
+
+    meta__sink_printf(sink, "static MetaTemplate meta__embedded_%d =\n{\n    (char*)\"", index);
+    for (const char* c = tmpl->path; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            meta_sink_write(sink, "\\", 1);
+        }
+        meta_sink_write(sink, c, 1);
+    }
+    meta__sink_printf(sink, "\",\n    meta__embedded_%d_source,\n    %lu,\n    meta__embedded_%d_segments,\n    %d,\n};\n\n",
+                      index, (unsigned long)tmpl->source_len, index, tmpl->num_segments);
+}
+
+int meta_embed_templates(
+        const char* result_path,
+        const char** tmpl_paths,
+        const int num_templates,
+        const char* depfile_path)
+{
+    MetaGenFile gen;
+    meta_gen_begin(&gen, result_path);
+    for (int i = 0; i < num_templates; ++i)
+    {
+        // Always from disk, even if an older copy is registered.
+        MetaTemplate* tmpl = meta__template_compile_file(tmpl_paths[i]);
+        if (!tmpl)
+        {
+            // Leave the old header alone.
+            meta_gen_discard(&gen);
+            return -1;
         }
+        meta__gen_add_dep(&gen, tmpl_paths[i]);
+        meta__embed_template(&gen.sink, tmpl, i);
+        meta_template_free(tmpl);
+    }
+
+    meta__sink_printf(&gen.sink, "static MetaTemplate* const meta_embedded_templates[] =\n{\n");
+    for (int i = 0; i < num_templates; ++i)
+    {
+        meta__sink_printf(&gen.sink, "    &meta__embedded_%d,\n", i);
+    }
+    if (!num_templates)
+    {
+        meta__sink_printf(&gen.sink, "    NULL,\n");
     }
+    meta__sink_printf(&gen.sink, "};\n\n#define META_NUM_EMBEDDED_TEMPLATES %d\n", num_templates);
+
+    return meta_gen_end(&gen, depfile_path);
 }
@@ -0,0 +1,182 @@
+// meta_bench.c
+//
+// Compares the SIMD template lexer in meta.h against the scalar state
+// machine, checks that both produce the same segments, and measures
+// expansion throughput and C lexing throughput.
+//
+// Build with -O2 (and -mavx2 to get the 32-byte path).
+
+// Builds the scalar reference lexer in meta.h.
+#define META_BENCH
+#include "meta.h"
+
+#define BENCH_TEMPLATE_SIZE (64 * 1024 * 1024)
+#define BENCH_RUNS 5
+
+static void check_same_segments(const char* src, size_t len)
+{
+    int scalar_count = meta__lex_template_scalar(src, len, NULL);
+    int fast_count = meta__lex_template_fast(src, len, NULL);
+    assert(scalar_count == fast_count);
+
+    MetaSegment* scalar = (MetaSegment*)malloc((scalar_count + 1) * sizeof(MetaSegment));
+    MetaSegment* fast = (MetaSegment*)malloc((fast_count + 1) * sizeof(MetaSegment));
+    meta__lex_template_scalar(src, len, scalar);
+    meta__lex_template_fast(src, len, fast);
+    for (int i = 0; i < scalar_count; ++i)
+    {
+        assert(scalar[i].kind == fast[i].kind);
+        assert(scalar[i].offset == fast[i].offset);
+        assert(scalar[i].len == fast[i].len);
+        assert(scalar[i].hash == fast[i].hash);
+    }
+    free(scalar);
+    free(fast);
+}
+
+// Random soup of the characters the lexer cares about, to hit stray '$',
+// unterminated slots and empty names.
+static void fuzz_lexers()
+{
+    static const char alphabet[] = "$$<<>>ab \n";
+    char src[256];
+    srand(1729);
+    for (int run = 0; run < 100000; ++run)
+    {
+        size_t len = (size_t)(rand() % sizeof(src));
+        for (size_t i = 0; i < len; ++i)
+        {
+            src[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        }
+        check_same_segments(src, len);
+    }
+}
+
+// The C lexer skips whitespace and identifier runs 16 bytes at a time.
+static void fuzz_class_runs()
+{
+    static const int classes[] = { META_CHAR_SPACE, META_CHAR_IDENT | META_CHAR_DIGIT };
+    char src[64];
+    for (int run = 0; run < 100000; ++run)
+    {
+        size_t len = (size_t)(rand() % sizeof(src));
+        for (size_t i = 0; i < len; ++i)
+        {
+            src[i] = (rand() % 4) ? "a_Z9 \t\v\f\r\n"[rand() % 11] : (char)rand();
+        }
+        for (int c = 0; c < 2; ++c)
+        {
+            size_t start = len ? (size_t)rand() % len : 0;
+            assert(meta__skip_class(src, start, len, classes[c]) ==
+                   meta__skip_class_scalar(src, start, len, classes[c]));
+        }
+    }
+}
+
+int main()
+{
+    fuzz_lexers();
+    fuzz_class_runs();
+    printf("Scalar and SIMD lexers agree.\n");
+
+    // Mostly literal C, like real templates.
+    static const char chunk[] =
+        "typedef struct $<name>_s\n"
+        "{\n"
+        "    union\n"
+        "    {\n"
+        "        struct\n"
+        "        {\n"
+        "            $<type> x;\n"
+        "            $<type> y;\n"
+        "        };\n"
+        "        $<type> d[2];\n"
+        "    };\n"
+        "} $<name>;\n"
+        "\n"
+        "static $<name> $<name>_add($<name> a, $<name> b)\n"
+        "{\n"
+        "    // Component-wise sum. Nothing to substitute on these lines, which is\n"
+        "    // what most of a template looks like.\n"
+        "    $<name> result = { a.x + b.x, a.y + b.y };\n"
+        "    return result;\n"
+        "}\n\n";
+    size_t chunk_len = sizeof(chunk) - 1;
+    size_t len = (BENCH_TEMPLATE_SIZE / chunk_len) * chunk_len;
+    char* src = (char*)malloc(len);
+    assert(src);
+    for (size_t i = 0; i < len; i += chunk_len)
+    {
+        memcpy(src + i, chunk, chunk_len);
+    }
+    check_same_segments(src, len);
+
+    int num_segments = meta__lex_template_fast(src, len, NULL);
+    MetaSegment* segments = (MetaSegment*)malloc((num_segments + 1) * sizeof(MetaSegment));
+    assert(segments);
+
+    double mb = (double)len / (1024.0 * 1024.0);
+    double best_scalar = 1e9;
+    double best_fast = 1e9;
+    for (int run = 0; run < BENCH_RUNS; ++run)
+    {
+        double t0 = meta__now();
+        meta__lex_template_scalar(src, len, segments);
+        double t1 = meta__now();
+        meta__lex_template_fast(src, len, segments);
+        double t2 = meta__now();
+        if (t1 - t0 < best_scalar) best_scalar = t1 - t0;
+        if (t2 - t1 < best_fast) best_fast = t2 - t1;
+    }
+    printf("Lexing %.0f MB, %d segments\n", mb, num_segments);
+    printf("    scalar: %8.1f MB/s\n", mb / best_scalar);
+    printf("    simd:   %8.1f MB/s\n", mb / best_fast);
+
+    // Expansion: lex + render into memory.
+    MetaTemplate tmpl = { 0 };
+    tmpl.path = (char*)"bench.adc";
+    tmpl.source = src;
+    tmpl.source_len = len;
+    tmpl.segments = segments;
+    tmpl.num_segments = num_segments;
+
+    MetaBinding bindings[] =
+    {
+        { "name", "v2f" },
+        { "type", "float" },
+    };
+
+    double best_render = 1e9;
+    size_t out_size = 0;
+    for (int run = 0; run < BENCH_RUNS; ++run)
+    {
+        MetaSink sink;
+        meta_sink_memory(&sink);
+        double t0 = meta__now();
+        meta__lex_template_fast(src, len, segments);
+        meta_template_render_sink(&tmpl, &sink, bindings, 2);
+        double t1 = meta__now();
+        if (t1 - t0 < best_render) best_render = t1 - t0;
+        out_size = sink.count;
+        meta_sink_close(&sink);
+    }
+    printf("Expanding into %.0f MB: %8.1f MB/s of output\n",
+           out_size / (1024.0 * 1024.0), (out_size / (1024.0 * 1024.0)) / best_render);
+
+    // The template source is C too, so it doubles as input for meta_lex_c.
+    double best_c = 1e9;
+    int num_tokens = 0;
+    for (int run = 0; run < BENCH_RUNS; ++run)
+    {
+        double t0 = meta__now();
+        MetaToken* tokens = meta_lex_c(src, len);
+        double t1 = meta__now();
+        if (t1 - t0 < best_c) best_c = t1 - t0;
+        num_tokens = sb_count(tokens);
+        meta_free_tokens(tokens);
+    }
+    printf("Lexing C, %d tokens: %8.1f MB/s\n", num_tokens, mb / best_c);
+
+    free(segments);
+    free(src);
+}